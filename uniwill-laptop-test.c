@@ -0,0 +1,822 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * KUnit tests for the Uniwill notebook driver.
+ *
+ * Copyright (C) 2024 Armin Wolf <W_Armin@gmx.de>
+ */
+
+#include <linux/acpi.h>
+#include <linux/array_size.h>
+#include <linux/delay.h>
+#include <linux/device.h>
+#include <linux/err.h>
+#include <linux/errno.h>
+#include <linux/hwmon.h>
+#include <linux/ktime.h>
+#include <linux/math.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/platform_profile.h>
+#include <linux/regmap.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/types.h>
+#include <linux/wmi.h>
+
+#include <asm/byteorder.h>
+
+#include <kunit/static_stub.h>
+#include <kunit/test.h>
+#include <kunit/test-bug.h>
+
+#include "uniwill-laptop.h"
+#include "uniwill-telemetry.h"
+
+/* Writeable registers which are only read during setup */
+#define TEST_REG_A	EC_ADDR_PL1_SETTING
+#define TEST_REG_B	EC_ADDR_PL2_SETTING
+#define TEST_REG_C	EC_ADDR_PL4_SETTING
+
+#define TEST_EC_SIZE	0x2000
+#define TEST_EC_WRITES	16
+
+/* Long enough for the flush work to never run during a test */
+#define TEST_COALESCE_DELAY	60000
+
+#define TEST_BENCH_LOOPS	16
+
+static unsigned int ec_latency = 100;
+module_param(ec_latency, uint, 0444);
+MODULE_PARM_DESC(ec_latency,
+		 "Simulated latency of each EC access in microseconds for the benchmark");
+
+struct uniwill_test_write {
+	unsigned int reg;
+	unsigned int value;
+};
+
+/* Stands in for the firmware behind uniwill_get_set_ulong() */
+struct uniwill_fake_ec {
+	u8 regs[TEST_EC_SIZE];
+	bool wide_read;		/* Reads return the following registers in the upper bytes */
+	unsigned int latency;	/* Delay of each access in microseconds */
+	unsigned int fail_reg;	/* Accesses to this register fail if non-zero */
+	unsigned int round_trips;
+	struct uniwill_test_write writes[TEST_EC_WRITES];
+	unsigned int write_count;
+};
+
+struct uniwill_test_ctx {
+	struct uniwill_fake_ec *ec;
+	struct wmi_device *wdev;
+	struct uniwill_data *data;
+};
+
+static int uniwill_fake_get_set_ulong(struct uniwill_data *data,
+				      struct uniwill_method_buffer *input, u32 *output)
+{
+	struct uniwill_test_ctx *ctx = kunit_get_current_test()->priv;
+	struct uniwill_fake_ec *ec = ctx->ec;
+	unsigned int reg = le16_to_cpu(input->address);
+	unsigned int i;
+
+	ec->round_trips++;
+
+	if (ec->latency)
+		fsleep(ec->latency);
+
+	/* The firmware does not fail the method when a register is inaccessible */
+	if (reg >= TEST_EC_SIZE || (ec->fail_reg && reg == ec->fail_reg)) {
+		*output = 0xFEFEFEFE;
+		return 0;
+	}
+
+	if (le16_to_cpu(input->operation) == 0x0100) {
+		*output = ec->regs[reg];
+		for (i = 1; ec->wide_read && i < sizeof(*output) && reg + i < TEST_EC_SIZE; i++)
+			*output |= (u32)ec->regs[reg + i] << (i * BITS_PER_BYTE);
+
+		return 0;
+	}
+
+	if (ec->write_count < ARRAY_SIZE(ec->writes)) {
+		ec->writes[ec->write_count].reg = reg;
+		ec->writes[ec->write_count].value = le16_to_cpu(input->data);
+	}
+	ec->write_count++;
+
+	ec->regs[reg] = le16_to_cpu(input->data);
+	*output = 0;
+
+	return 0;
+}
+
+static void uniwill_test_release(struct device *dev)
+{
+	kfree(container_of(dev, struct wmi_device, dev));
+}
+
+static void uniwill_test_put_device(void *context)
+{
+	put_device(context);
+}
+
+/* The registers of the fake EC have to be set beforehand, since they are cached during setup */
+static struct uniwill_data *uniwill_test_setup(struct kunit *test, unsigned int coalesce_delay)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	struct wmi_device *wdev;
+	int ret;
+
+	wdev = kzalloc(sizeof(*wdev), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, wdev);
+
+	/* The device is never registered, it only holds the resources of the driver */
+	device_initialize(&wdev->dev);
+	wdev->dev.release = uniwill_test_release;
+
+	ret = kunit_add_action_or_reset(test, uniwill_test_put_device, &wdev->dev);
+	KUNIT_ASSERT_EQ(test, ret, 0);
+
+	ret = dev_set_name(&wdev->dev, "kunit");
+	KUNIT_ASSERT_EQ(test, ret, 0);
+
+	ctx->wdev = wdev;
+	ctx->data = uniwill_data_init(wdev, coalesce_delay);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx->data);
+
+	/* Only count the accesses made by the test itself */
+	ctx->ec->round_trips = 0;
+	ctx->ec->write_count = 0;
+
+	return ctx->data;
+}
+
+static void uniwill_test_expect_write(struct kunit *test, unsigned int index, unsigned int reg,
+				      unsigned int value)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+
+	KUNIT_ASSERT_LT(test, index, ctx->ec->write_count);
+	KUNIT_EXPECT_EQ(test, ctx->ec->writes[index].reg, reg);
+	KUNIT_EXPECT_EQ(test, ctx->ec->writes[index].value, value);
+}
+
+static void uniwill_test_parse_reply(struct kunit *test)
+{
+	u8 payload[] = { 0x78, 0x56, 0x34, 0x12 };
+	union acpi_object obj = {
+		.buffer = {
+			.type = ACPI_TYPE_BUFFER,
+			.length = sizeof(payload),
+			.pointer = payload,
+		},
+	};
+	struct acpi_buffer out = {
+		.length = sizeof(obj),
+		.pointer = &obj,
+	};
+	struct acpi_buffer empty = {};
+	u32 value = 0;
+
+	KUNIT_EXPECT_EQ(test, uniwill_parse_reply(&empty, &value), -ENODATA);
+
+	KUNIT_EXPECT_EQ(test, uniwill_parse_reply(&out, &value), 0);
+	KUNIT_EXPECT_EQ(test, value, 0x12345678);
+
+	obj.buffer.length = sizeof(payload) - 1;
+	KUNIT_EXPECT_EQ(test, uniwill_parse_reply(&out, &value), -EPROTO);
+
+	obj.type = ACPI_TYPE_INTEGER;
+	KUNIT_EXPECT_EQ(test, uniwill_parse_reply(&out, &value), -ENOMSG);
+}
+
+static void uniwill_test_telemetry_profile(struct kunit *test)
+{
+	KUNIT_EXPECT_EQ(test, uniwill_telemetry_profile(PLATFORM_PROFILE_LOW_POWER),
+			UNIWILL_TELEMETRY_PROFILE_LOW_POWER);
+	KUNIT_EXPECT_EQ(test, uniwill_telemetry_profile(PLATFORM_PROFILE_QUIET),
+			UNIWILL_TELEMETRY_PROFILE_QUIET);
+	KUNIT_EXPECT_EQ(test, uniwill_telemetry_profile(PLATFORM_PROFILE_BALANCED),
+			UNIWILL_TELEMETRY_PROFILE_BALANCED);
+	KUNIT_EXPECT_EQ(test, uniwill_telemetry_profile(PLATFORM_PROFILE_BALANCED_PERFORMANCE),
+			UNIWILL_TELEMETRY_PROFILE_BALANCED_PERFORMANCE);
+	KUNIT_EXPECT_EQ(test, uniwill_telemetry_profile(PLATFORM_PROFILE_PERFORMANCE),
+			UNIWILL_TELEMETRY_PROFILE_PERFORMANCE);
+	KUNIT_EXPECT_EQ(test, uniwill_telemetry_profile(PLATFORM_PROFILE_COOL),
+			UNIWILL_TELEMETRY_PROFILE_UNKNOWN);
+}
+
+/* Relies on the default thresholds of 1 degree Celsius and 100 RPM */
+static void uniwill_test_sensors_changed(struct kunit *test)
+{
+	struct uniwill_sensors old = {
+		.temp = { 50, 60 },
+		.fan = { 2000, 2500 },
+		.pwm = { 100, 120 },
+	};
+	struct uniwill_sensors new = old;
+
+	KUNIT_EXPECT_FALSE(test, uniwill_sensors_changed(&old, &new));
+
+	new.fan[1] += 50;
+	KUNIT_EXPECT_FALSE(test, uniwill_sensors_changed(&old, &new));
+
+	new.fan[1] = old.fan[1] - 200;
+	KUNIT_EXPECT_TRUE(test, uniwill_sensors_changed(&old, &new));
+
+	new = old;
+	new.temp[0]--;
+	KUNIT_EXPECT_TRUE(test, uniwill_sensors_changed(&old, &new));
+
+	new = old;
+	new.pwm[1]++;
+	KUNIT_EXPECT_TRUE(test, uniwill_sensors_changed(&old, &new));
+}
+
+static void uniwill_test_curve_lookup(struct kunit *test)
+{
+	static const u8 temps[FAN_CURVE_LENGTH] = { 40, 50, 60, 70, 80 };
+	static const u8 pwm[FAN_CURVE_LENGTH] = { 40, 80, 120, 160, 200 };
+
+	/* Below and above the curve the outermost points apply */
+	KUNIT_EXPECT_EQ(test, uniwill_curve_lookup(temps, pwm, 0), 40);
+	KUNIT_EXPECT_EQ(test, uniwill_curve_lookup(temps, pwm, 40), 40);
+	KUNIT_EXPECT_EQ(test, uniwill_curve_lookup(temps, pwm, 80), 200);
+	KUNIT_EXPECT_EQ(test, uniwill_curve_lookup(temps, pwm, 255), 200);
+
+	KUNIT_EXPECT_EQ(test, uniwill_curve_lookup(temps, pwm, 45), 60);
+	KUNIT_EXPECT_EQ(test, uniwill_curve_lookup(temps, pwm, 50), 80);
+	KUNIT_EXPECT_EQ(test, uniwill_curve_lookup(temps, pwm, 75), 180);
+}
+
+static void uniwill_test_fan_target(struct kunit *test)
+{
+	static const u8 temps[FAN_CURVE_LENGTH] = { 40, 50, 60, 70, 80 };
+	static const u8 pwm[FAN_CURVE_LENGTH] = { 40, 80, 120, 160, 200 };
+
+	KUNIT_EXPECT_EQ(test, uniwill_fan_target(temps, pwm, 65, 120, 3), 140);
+
+	/* Within the hysteresis the fan keeps its speed instead of speeding up */
+	KUNIT_EXPECT_EQ(test, uniwill_fan_target(temps, pwm, 59, 120, 3), 120);
+	KUNIT_EXPECT_EQ(test, uniwill_fan_target(temps, pwm, 55, 120, 3), 112);
+	KUNIT_EXPECT_EQ(test, uniwill_fan_target(temps, pwm, 55, 120, 0), 100);
+}
+
+static void uniwill_test_limits_ordered(struct kunit *test)
+{
+	unsigned int limits[UNIWILL_LIMIT_COUNT] = {};
+
+	limits[UNIWILL_LIMIT_PL1] = 35;
+	limits[UNIWILL_LIMIT_PL2] = 65;
+	limits[UNIWILL_LIMIT_PL4] = 120;
+	KUNIT_EXPECT_TRUE(test, uniwill_limits_ordered(limits));
+
+	limits[UNIWILL_LIMIT_PL2] = 35;
+	KUNIT_EXPECT_TRUE(test, uniwill_limits_ordered(limits));
+
+	limits[UNIWILL_LIMIT_PL2] = 30;
+	KUNIT_EXPECT_FALSE(test, uniwill_limits_ordered(limits));
+
+	limits[UNIWILL_LIMIT_PL2] = 130;
+	KUNIT_EXPECT_FALSE(test, uniwill_limits_ordered(limits));
+}
+
+static void uniwill_test_update_direct(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	struct uniwill_data *data;
+
+	ctx->ec->regs[TEST_REG_A] = 0x0F;
+	data = uniwill_test_setup(test, 0);
+
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_A, 0x30, 0x10), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 1);
+	uniwill_test_expect_write(test, 0, TEST_REG_A, 0x1F);
+}
+
+static void uniwill_test_coalesce_merge(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	struct uniwill_data *data;
+	unsigned int value;
+
+	ctx->ec->regs[TEST_REG_A] = 0x01;
+	data = uniwill_test_setup(test, TEST_COALESCE_DELAY);
+
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_A, 0x40, 0x40), 0);
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_A, 0x80, 0x80), 0);
+	/* Later updates overlay earlier ones */
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_A, 0x41, 0x00), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 0);
+
+	/* Reads already see the pending update */
+	KUNIT_EXPECT_EQ(test, uniwill_read_reg(data, TEST_REG_A, &value), 0);
+	KUNIT_EXPECT_EQ(test, value, 0x80);
+
+	KUNIT_EXPECT_EQ(test, uniwill_flush_writes(data), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 1);
+	uniwill_test_expect_write(test, 0, TEST_REG_A, 0x80);
+}
+
+static void uniwill_test_coalesce_order(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	struct uniwill_data *data = uniwill_test_setup(test, TEST_COALESCE_DELAY);
+
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_A, 0x01, 0x01), 0);
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_B, 0x01, 0x01), 0);
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_A, 0x02, 0x02), 0);
+
+	KUNIT_EXPECT_EQ(test, uniwill_flush_writes(data), 0);
+
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 2);
+	uniwill_test_expect_write(test, 0, TEST_REG_A, 0x03);
+	uniwill_test_expect_write(test, 1, TEST_REG_B, 0x01);
+}
+
+static void uniwill_test_write_flushes_pending(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	struct uniwill_data *data = uniwill_test_setup(test, TEST_COALESCE_DELAY);
+
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_A, 0x40, 0x40), 0);
+	KUNIT_EXPECT_EQ(test, uniwill_write_reg(data, TEST_REG_B, 100), 0);
+
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 2);
+	uniwill_test_expect_write(test, 0, TEST_REG_A, 0x40);
+	uniwill_test_expect_write(test, 1, TEST_REG_B, 100);
+
+	/* Values already held by the EC are not written again */
+	KUNIT_EXPECT_EQ(test, uniwill_write_reg(data, TEST_REG_B, 100), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 2);
+}
+
+static void uniwill_test_coalesce_error(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	struct uniwill_data *data = uniwill_test_setup(test, TEST_COALESCE_DELAY);
+
+	ctx->ec->fail_reg = TEST_REG_A;
+
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_A, 0x01, 0x01), 0);
+	KUNIT_EXPECT_EQ(test, uniwill_flush_writes(data), -ENXIO);
+
+	/* The failed update is dropped and does not affect later updates */
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_B, 0x01, 0x01), 0);
+
+	KUNIT_EXPECT_EQ(test, uniwill_flush_writes(data), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 1);
+	uniwill_test_expect_write(test, 0, TEST_REG_B, 0x01);
+}
+
+static void uniwill_test_transaction(struct kunit *test)
+{
+	static const struct uniwill_pending_write writes[] = {
+		{ .reg = TEST_REG_A, .mask = 0xFF, .value = 0x01 },
+		{ .reg = TEST_REG_B, .mask = 0x0F, .value = 0x05 },
+		{ .reg = TEST_REG_C, .mask = 0xFF, .value = 0x03 },
+	};
+	struct uniwill_test_ctx *ctx = test->priv;
+	unsigned int old[ARRAY_SIZE(writes)];
+	struct uniwill_data *data;
+
+	ctx->ec->regs[TEST_REG_A] = 0x11;
+	ctx->ec->regs[TEST_REG_B] = 0x22;
+	ctx->ec->regs[TEST_REG_C] = 0x33;
+	data = uniwill_test_setup(test, 0);
+
+	KUNIT_EXPECT_EQ(test, uniwill_write_transaction(data, writes, ARRAY_SIZE(writes), old), 0);
+	KUNIT_EXPECT_EQ(test, old[0], 0x11);
+	KUNIT_EXPECT_EQ(test, old[1], 0x22);
+	KUNIT_EXPECT_EQ(test, old[2], 0x33);
+
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 3);
+	uniwill_test_expect_write(test, 0, TEST_REG_A, 0x01);
+	uniwill_test_expect_write(test, 1, TEST_REG_B, 0x25);
+	uniwill_test_expect_write(test, 2, TEST_REG_C, 0x03);
+}
+
+static void uniwill_test_transaction_merge(struct kunit *test)
+{
+	static const struct uniwill_pending_write writes[] = {
+		{ .reg = TEST_REG_A, .mask = 0x06, .value = 0x04 },
+	};
+	struct uniwill_test_ctx *ctx = test->priv;
+	struct uniwill_data *data = uniwill_test_setup(test, TEST_COALESCE_DELAY);
+	unsigned int old[ARRAY_SIZE(writes)];
+
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_B, 0x01, 0x01), 0);
+	KUNIT_EXPECT_EQ(test, uniwill_update_bits(data, TEST_REG_A, 0x03, 0x01), 0);
+
+	/* The pending update of TEST_REG_A is written together with the transaction */
+	KUNIT_EXPECT_EQ(test, uniwill_write_transaction(data, writes, ARRAY_SIZE(writes), old), 0);
+	KUNIT_EXPECT_EQ(test, old[0], 0x00);
+
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 2);
+	uniwill_test_expect_write(test, 0, TEST_REG_B, 0x01);
+	uniwill_test_expect_write(test, 1, TEST_REG_A, 0x05);
+
+	KUNIT_EXPECT_EQ(test, uniwill_flush_writes(data), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 2);
+}
+
+static void uniwill_test_transaction_rollback(struct kunit *test)
+{
+	static const struct uniwill_pending_write writes[] = {
+		{ .reg = TEST_REG_A, .mask = 0xFF, .value = 0x01 },
+		{ .reg = TEST_REG_B, .mask = 0xFF, .value = 0x02 },
+		{ .reg = TEST_REG_C, .mask = 0xFF, .value = 0x03 },
+	};
+	struct uniwill_test_ctx *ctx = test->priv;
+	unsigned int old[ARRAY_SIZE(writes)];
+	struct uniwill_data *data;
+
+	ctx->ec->regs[TEST_REG_A] = 0x11;
+	ctx->ec->regs[TEST_REG_B] = 0x22;
+	ctx->ec->regs[TEST_REG_C] = 0x33;
+	data = uniwill_test_setup(test, 0);
+
+	ctx->ec->fail_reg = TEST_REG_C;
+
+	KUNIT_EXPECT_EQ(test, uniwill_write_transaction(data, writes, ARRAY_SIZE(writes), old),
+			-ENXIO);
+
+	/* The applied writes are undone in reverse order */
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 4);
+	uniwill_test_expect_write(test, 0, TEST_REG_A, 0x01);
+	uniwill_test_expect_write(test, 1, TEST_REG_B, 0x02);
+	uniwill_test_expect_write(test, 2, TEST_REG_B, 0x22);
+	uniwill_test_expect_write(test, 3, TEST_REG_A, 0x11);
+
+	KUNIT_EXPECT_EQ(test, ctx->ec->regs[TEST_REG_A], 0x11);
+	KUNIT_EXPECT_EQ(test, ctx->ec->regs[TEST_REG_B], 0x22);
+	KUNIT_EXPECT_EQ(test, ctx->ec->regs[TEST_REG_C], 0x33);
+}
+
+static void uniwill_test_fill_romid(struct uniwill_fake_ec *ec)
+{
+	unsigned int i;
+
+	/* The wide read probe needs a ROM ID which does not consist of identical bytes */
+	for (i = 0; i < ROMID_LENGTH; i++)
+		ec->regs[EC_ADDR_ROMID_START + i] = i + 1;
+}
+
+static void uniwill_test_wide_read(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	u8 romid[ROMID_LENGTH];
+	struct regmap *regmap;
+	struct device *dev;
+	unsigned int i;
+	long value;
+	int ret;
+
+	uniwill_test_fill_romid(ctx->ec);
+	ctx->ec->regs[EC_ADDR_MAIN_FAN_RPM_1] = 0x12;
+	ctx->ec->regs[EC_ADDR_MAIN_FAN_RPM_2] = 0x34;
+	ctx->ec->wide_read = true;
+	uniwill_test_setup(test, 0);
+	dev = &ctx->wdev->dev;
+
+	/* Both bytes of the fan speed are read at once */
+	KUNIT_EXPECT_EQ(test, uniwill_read(dev, hwmon_fan, hwmon_fan_input, 0, &value), 0);
+	KUNIT_EXPECT_EQ(test, value, 0x1234);
+	KUNIT_EXPECT_EQ(test, ctx->ec->round_trips, 1);
+
+	regmap = dev_get_regmap(dev, NULL);
+	KUNIT_ASSERT_NOT_NULL(test, regmap);
+
+	/* Longer reads are split into chunks of four registers */
+	regcache_cache_bypass(regmap, true);
+	ret = regmap_raw_read(regmap, EC_ADDR_ROMID_START, romid, sizeof(romid));
+	regcache_cache_bypass(regmap, false);
+
+	KUNIT_EXPECT_EQ(test, ret, 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->round_trips, 1 + DIV_ROUND_UP(ROMID_LENGTH, sizeof(u32)));
+	for (i = 0; i < ROMID_LENGTH; i++)
+		KUNIT_EXPECT_EQ(test, romid[i], i + 1);
+}
+
+static void uniwill_test_single_read(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	long value;
+
+	/* The firmware only returns the requested register */
+	uniwill_test_fill_romid(ctx->ec);
+	ctx->ec->regs[EC_ADDR_MAIN_FAN_RPM_1] = 0x12;
+	ctx->ec->regs[EC_ADDR_MAIN_FAN_RPM_2] = 0x34;
+	uniwill_test_setup(test, 0);
+
+	KUNIT_EXPECT_EQ(test, uniwill_read(&ctx->wdev->dev, hwmon_fan, hwmon_fan_input, 0, &value),
+			0);
+	KUNIT_EXPECT_EQ(test, value, 0x1234);
+	KUNIT_EXPECT_EQ(test, ctx->ec->round_trips, 2);
+}
+
+static void uniwill_test_hwmon_read(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	struct device *dev;
+	long value;
+
+	ctx->ec->regs[EC_ADDR_CPU_TEMP] = 45;
+	ctx->ec->regs[EC_ADDR_PWM_1] = 100;
+	ctx->ec->regs[EC_ADDR_MANUAL_FAN_CTRL] = FAN_MODE_BOOST;
+	uniwill_test_setup(test, 0);
+	dev = &ctx->wdev->dev;
+
+	/* Temperatures are volatile and always read from the EC */
+	KUNIT_EXPECT_EQ(test, uniwill_read(dev, hwmon_temp, hwmon_temp_input, 0, &value), 0);
+	KUNIT_EXPECT_EQ(test, value, 45000);
+	KUNIT_EXPECT_EQ(test, uniwill_read(dev, hwmon_temp, hwmon_temp_input, 0, &value), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->round_trips, 2);
+
+	/* The duty cycle is served from the regmap cache after the first read */
+	KUNIT_EXPECT_EQ(test, uniwill_read(dev, hwmon_pwm, hwmon_pwm_input, 0, &value), 0);
+	KUNIT_EXPECT_EQ(test, value, 127);
+	KUNIT_EXPECT_EQ(test, uniwill_read(dev, hwmon_pwm, hwmon_pwm_input, 0, &value), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->round_trips, 3);
+
+	KUNIT_EXPECT_EQ(test, uniwill_read(dev, hwmon_pwm, hwmon_pwm_enable, 0, &value), 0);
+	KUNIT_EXPECT_EQ(test, value, 1);
+
+	/* The firmware reports inaccessible registers with a magic value */
+	ctx->ec->fail_reg = EC_ADDR_CPU_TEMP;
+	KUNIT_EXPECT_EQ(test, uniwill_read(dev, hwmon_temp, hwmon_temp_input, 0, &value), -ENXIO);
+}
+
+static void uniwill_test_profile(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	enum platform_profile_option profile;
+	struct uniwill_data *data;
+	unsigned int round_trips;
+
+	ctx->ec->regs[EC_ADDR_SUPPORT_2] = SILENT_MODE;
+	ctx->ec->regs[EC_ADDR_PL1_SETTING] = 35;
+	ctx->ec->regs[EC_ADDR_PL2_SETTING] = 65;
+	ctx->ec->regs[EC_ADDR_PL4_SETTING] = 120;
+	ctx->ec->regs[EC_ADDR_MANUAL_FAN_CTRL] = FAN_MODE_USER | FAN_MODE_HIGH;
+	data = uniwill_test_setup(test, 0);
+
+	KUNIT_EXPECT_EQ(test, uniwill_profile_get(data, &profile), 0);
+	KUNIT_EXPECT_EQ(test, profile, PLATFORM_PROFILE_BALANCED);
+
+	/* The limits are raised starting with PL4 and the fan mode comes last */
+	KUNIT_EXPECT_EQ(test, uniwill_profile_set(data, PLATFORM_PROFILE_PERFORMANCE), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 3);
+	uniwill_test_expect_write(test, 0, EC_ADDR_PL1_SETTING, 65);
+	uniwill_test_expect_write(test, 1, EC_ADDR_OEM_3, OVERBOOST);
+	uniwill_test_expect_write(test, 2, EC_ADDR_MANUAL_FAN_CTRL, FAN_MODE_TURBO);
+
+	round_trips = ctx->ec->round_trips;
+	KUNIT_EXPECT_EQ(test, uniwill_profile_get(data, &profile), 0);
+	KUNIT_EXPECT_EQ(test, profile, PLATFORM_PROFILE_PERFORMANCE);
+	KUNIT_EXPECT_EQ(test, ctx->ec->round_trips, round_trips);
+
+	/* The limits are lowered starting with PL1 */
+	ctx->ec->write_count = 0;
+	KUNIT_EXPECT_EQ(test, uniwill_profile_set(data, PLATFORM_PROFILE_QUIET), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 4);
+	uniwill_test_expect_write(test, 0, EC_ADDR_PL1_SETTING, 26);
+	uniwill_test_expect_write(test, 1, EC_ADDR_PL2_SETTING, 35);
+	uniwill_test_expect_write(test, 2, EC_ADDR_OEM_3, FAN_QUIET);
+	uniwill_test_expect_write(test, 3, EC_ADDR_MANUAL_FAN_CTRL, FAN_MODE_USER | FAN_MODE_HIGH);
+
+	/* The EC uses the same fan mode for the balanced profile */
+	KUNIT_EXPECT_EQ(test, uniwill_profile_get(data, &profile), 0);
+	KUNIT_EXPECT_EQ(test, profile, PLATFORM_PROFILE_QUIET);
+
+	KUNIT_EXPECT_EQ(test, uniwill_profile_set(data, PLATFORM_PROFILE_COOL), -EINVAL);
+}
+
+static void uniwill_test_profile_optional(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	struct uniwill_data *data;
+
+	/* Without EC_ADDR_OEM_3 and SILENT_MODE the profiles only switch the fan mode */
+	ctx->ec->fail_reg = EC_ADDR_OEM_3;
+	data = uniwill_test_setup(test, 0);
+
+	KUNIT_EXPECT_EQ(test, uniwill_profile_set(data, PLATFORM_PROFILE_PERFORMANCE), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 1);
+	uniwill_test_expect_write(test, 0, EC_ADDR_MANUAL_FAN_CTRL, FAN_MODE_TURBO);
+
+	KUNIT_EXPECT_EQ(test, uniwill_profile_set(data, PLATFORM_PROFILE_QUIET), -EOPNOTSUPP);
+}
+
+/* The background sampler would access the fake EC outside of the test */
+static void uniwill_test_skip_sampling(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	long interval;
+	int ret;
+
+	ret = uniwill_read(&ctx->wdev->dev, hwmon_chip, hwmon_chip_update_interval, 0, &interval);
+	KUNIT_ASSERT_EQ(test, ret, 0);
+
+	if (interval)
+		kunit_skip(test, "background sampling is enabled");
+}
+
+static void uniwill_test_suspend_resume(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx = test->priv;
+	struct uniwill_data *data;
+	struct device *dev;
+
+	ctx->ec->regs[EC_ADDR_PL1_SETTING] = 35;
+	ctx->ec->regs[EC_ADDR_PL2_SETTING] = 65;
+	data = uniwill_test_setup(test, 0);
+	dev = &ctx->wdev->dev;
+
+	uniwill_test_skip_sampling(test);
+
+	KUNIT_EXPECT_EQ(test, ctx->ec->regs[EC_ADDR_AP_OEM], ENABLE_MANUAL_CTRL);
+	KUNIT_ASSERT_EQ(test, uniwill_suspend(dev), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->regs[EC_ADDR_AP_OEM], 0);
+
+	/* Changes made while suspended only reach the EC during resume */
+	ctx->ec->write_count = 0;
+	KUNIT_EXPECT_EQ(test, uniwill_write_reg(data, EC_ADDR_PL1_SETTING, 42), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->write_count, 0);
+
+	/* The EC might lose its settings while suspended */
+	ctx->ec->regs[EC_ADDR_PL2_SETTING] = 0;
+
+	KUNIT_ASSERT_EQ(test, uniwill_resume(dev), 0);
+	KUNIT_EXPECT_EQ(test, ctx->ec->regs[EC_ADDR_AP_OEM], ENABLE_MANUAL_CTRL);
+	KUNIT_EXPECT_EQ(test, ctx->ec->regs[EC_ADDR_PL1_SETTING], 42);
+	KUNIT_EXPECT_EQ(test, ctx->ec->regs[EC_ADDR_PL2_SETTING], 65);
+}
+
+struct uniwill_test_bench {
+	const char *name;
+	int (*run)(struct uniwill_test_ctx *ctx, unsigned int iteration);
+};
+
+static int uniwill_bench_temp(struct uniwill_test_ctx *ctx, unsigned int iteration)
+{
+	long value;
+
+	return uniwill_read(&ctx->wdev->dev, hwmon_temp, hwmon_temp_input, 0, &value);
+}
+
+static int uniwill_bench_fan(struct uniwill_test_ctx *ctx, unsigned int iteration)
+{
+	long value;
+
+	return uniwill_read(&ctx->wdev->dev, hwmon_fan, hwmon_fan_input, 0, &value);
+}
+
+static int uniwill_bench_bulk(struct uniwill_test_ctx *ctx, unsigned int iteration)
+{
+	struct regmap *regmap = dev_get_regmap(&ctx->wdev->dev, NULL);
+	u8 romid[ROMID_LENGTH];
+	int ret;
+
+	regcache_cache_bypass(regmap, true);
+	ret = regmap_raw_read(regmap, EC_ADDR_ROMID_START, romid, sizeof(romid));
+	regcache_cache_bypass(regmap, false);
+
+	return ret;
+}
+
+static int uniwill_bench_profile_get(struct uniwill_test_ctx *ctx, unsigned int iteration)
+{
+	enum platform_profile_option profile;
+
+	return uniwill_profile_get(ctx->data, &profile);
+}
+
+static int uniwill_bench_profile_set(struct uniwill_test_ctx *ctx, unsigned int iteration)
+{
+	if (iteration % 2)
+		return uniwill_profile_set(ctx->data, PLATFORM_PROFILE_BALANCED);
+
+	return uniwill_profile_set(ctx->data, PLATFORM_PROFILE_PERFORMANCE);
+}
+
+static int uniwill_bench_suspend(struct uniwill_test_ctx *ctx, unsigned int iteration)
+{
+	int ret;
+
+	ret = uniwill_suspend(&ctx->wdev->dev);
+	if (ret < 0)
+		return ret;
+
+	return uniwill_resume(&ctx->wdev->dev);
+}
+
+static const struct uniwill_test_bench uniwill_test_benches[] = {
+	{ "temperature read", uniwill_bench_temp },
+	{ "fan speed read", uniwill_bench_fan },
+	{ "ROM ID bulk read", uniwill_bench_bulk },
+	{ "profile get", uniwill_bench_profile_get },
+	{ "profile set", uniwill_bench_profile_set },
+	{ "suspend and resume", uniwill_bench_suspend },
+};
+
+static const bool uniwill_test_wide_reads[] = { false, true };
+
+static void uniwill_test_wide_read_desc(const bool *wide_read, char *desc)
+{
+	strscpy(desc, *wide_read ? "wide reads" : "single reads", KUNIT_PARAM_DESC_SIZE);
+}
+
+KUNIT_ARRAY_PARAM(uniwill_test_read_mode, uniwill_test_wide_reads, uniwill_test_wide_read_desc);
+
+/* Reports the WMI round trips and the time per operation against a slow EC */
+static void uniwill_test_benchmark(struct kunit *test)
+{
+	const bool *wide_read = test->param_value;
+	struct uniwill_test_ctx *ctx = test->priv;
+	const struct uniwill_test_bench *bench;
+	unsigned int i, j;
+	u64 start, duration;
+
+	uniwill_test_fill_romid(ctx->ec);
+	ctx->ec->wide_read = *wide_read;
+	uniwill_test_setup(test, 0);
+
+	uniwill_test_skip_sampling(test);
+
+	ctx->ec->latency = ec_latency;
+
+	for (i = 0; i < ARRAY_SIZE(uniwill_test_benches); i++) {
+		bench = &uniwill_test_benches[i];
+		ctx->ec->round_trips = 0;
+
+		start = ktime_get_ns();
+		for (j = 0; j < TEST_BENCH_LOOPS; j++)
+			KUNIT_ASSERT_EQ(test, bench->run(ctx, j), 0);
+		duration = ktime_get_ns() - start;
+
+		kunit_info(test, "%s: %u.%02u round trips, %llu ns\n", bench->name,
+			   ctx->ec->round_trips / TEST_BENCH_LOOPS,
+			   ctx->ec->round_trips % TEST_BENCH_LOOPS * 100 / TEST_BENCH_LOOPS,
+			   div_u64(duration, TEST_BENCH_LOOPS));
+	}
+}
+
+static int uniwill_test_init(struct kunit *test)
+{
+	struct uniwill_test_ctx *ctx;
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	ctx->ec = kunit_kzalloc(test, sizeof(*ctx->ec), GFP_KERNEL);
+	if (!ctx->ec)
+		return -ENOMEM;
+
+	test->priv = ctx;
+
+	/* Activated first, so that it outlives the driver resources released during cleanup */
+	kunit_activate_static_stub(test, uniwill_get_set_ulong, uniwill_fake_get_set_ulong);
+
+	return 0;
+}
+
+static struct kunit_case uniwill_test_cases[] = {
+	KUNIT_CASE(uniwill_test_parse_reply),
+	KUNIT_CASE(uniwill_test_telemetry_profile),
+	KUNIT_CASE(uniwill_test_sensors_changed),
+	KUNIT_CASE(uniwill_test_curve_lookup),
+	KUNIT_CASE(uniwill_test_fan_target),
+	KUNIT_CASE(uniwill_test_limits_ordered),
+	KUNIT_CASE(uniwill_test_update_direct),
+	KUNIT_CASE(uniwill_test_coalesce_merge),
+	KUNIT_CASE(uniwill_test_coalesce_order),
+	KUNIT_CASE(uniwill_test_write_flushes_pending),
+	KUNIT_CASE(uniwill_test_coalesce_error),
+	KUNIT_CASE(uniwill_test_transaction),
+	KUNIT_CASE(uniwill_test_transaction_merge),
+	KUNIT_CASE(uniwill_test_transaction_rollback),
+	KUNIT_CASE(uniwill_test_wide_read),
+	KUNIT_CASE(uniwill_test_single_read),
+	KUNIT_CASE(uniwill_test_hwmon_read),
+	KUNIT_CASE(uniwill_test_profile),
+	KUNIT_CASE(uniwill_test_profile_optional),
+	KUNIT_CASE(uniwill_test_suspend_resume),
+	KUNIT_CASE_PARAM_ATTR(uniwill_test_benchmark, uniwill_test_read_mode_gen_params,
+			      { .speed = KUNIT_SPEED_SLOW }),
+	{}
+};
+
+static struct kunit_suite uniwill_test_suite = {
+	.name = "uniwill-laptop",
+	.init = uniwill_test_init,
+	.test_cases = uniwill_test_cases,
+};
+kunit_test_suite(uniwill_test_suite);
+
+MODULE_AUTHOR("Armin Wolf <W_Armin@gmx.de>");
+MODULE_DESCRIPTION("KUnit tests for the Uniwill notebook driver");
+MODULE_LICENSE("GPL");
+MODULE_IMPORT_NS(EXPORTED_FOR_KUNIT_TESTING);
@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Tracepoints for the Linux driver for Uniwill notebooks.
+ *
+ * Copyright (C) 2024 Armin Wolf <W_Armin@gmx.de>
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM uniwill
+
+#if !defined(UNIWILL_LAPTOP_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define UNIWILL_LAPTOP_TRACE_H
+
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+
+DECLARE_EVENT_CLASS(uniwill_ec_access,
+	TP_PROTO(unsigned int reg, u32 value, int ret, u64 duration),
+
+	TP_ARGS(reg, value, ret, duration),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, reg)
+		__field(u32, value)
+		__field(int, ret)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->reg = reg;
+		__entry->value = value;
+		__entry->ret = ret;
+		__entry->duration = duration;
+	),
+
+	TP_printk("reg=0x%04x value=0x%08x ret=%d duration=%llu ns", __entry->reg, __entry->value,
+		  __entry->ret, __entry->duration)
+);
+
+DEFINE_EVENT(uniwill_ec_access, uniwill_ec_read,
+	TP_PROTO(unsigned int reg, u32 value, int ret, u64 duration),
+
+	TP_ARGS(reg, value, ret, duration)
+);
+
+DEFINE_EVENT(uniwill_ec_access, uniwill_ec_write,
+	TP_PROTO(unsigned int reg, u32 value, int ret, u64 duration),
+
+	TP_ARGS(reg, value, ret, duration)
+);
+
+#endif /* UNIWILL_LAPTOP_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE uniwill-laptop-trace
+
+#include <trace/define_trace.h>
@@ -12,215 +12,273 @@
 #include <linux/bitfield.h>
 #include <linux/container_of.h>
 #include <linux/debugfs.h>
+#include <linux/devm-helpers.h>
 #include <linux/device.h>
 #include <linux/device/driver.h>
+#include <linux/err.h>
 #include <linux/errno.h>
 #include <linux/fixp-arith.h>
+#include <linux/fs.h>
+#include <linux/gfp.h>
 #include <linux/hwmon.h>
+#include <linux/hwmon-sysfs.h>
+#include <linux/idr.h>
+#include <linux/jiffies.h>
 #include <linux/kernel.h>
+#include <linux/kfifo.h>
+#include <linux/kref.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
 #include <linux/minmax.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/platform_profile.h>
 #include <linux/pm.h>
+#include <linux/poll.h>
 #include <linux/printk.h>
 #include <linux/regmap.h>
+#include <linux/seq_file.h>
+#include <linux/seqlock.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/thermal.h>
 #include <linux/types.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
 #include <linux/wmi.h>
+#include <linux/workqueue.h>
+#include <linux/xarray.h>
 
 #include <asm/unaligned.h>
 
-#include "uniwill-wmi.h"
-
-#define EC_ADDR_BAT_STATUS	0x0432
-#define BAT_DISCHARGING		BIT(0)
-
-#define EC_ADDR_CPU_TEMP	0x043E
-
-#define EC_ADDR_GPU_TEMP	0x044F
-
-#define EC_ADDR_MAIN_FAN_RPM_1	0x0464
-
-#define EC_ADDR_MAIN_FAN_RPM_2	0x0465
-
-#define EC_ADDR_SECOND_FAN_RPM_1	0x046C
-
-#define EC_ADDR_SECOND_FAN_RPM_2	0x046D
+#include <kunit/static_stub.h>
+#include <kunit/visibility.h>
 
-#define EC_ADDR_BAT_ALLERT	0x0494
-
-#define EC_ADDR_PROJECT_ID	0x0740
-
-#define EC_ADDR_AP_OEM		0x0741
-#define	ENABLE_MANUAL_CTRL	BIT(0)
-#define ITE_KBD_EFFECT_REACTIVE	BIT(3)
-#define FAN_ABNORMAL		BIT(5)
-
-#define EC_ADDR_SUPPORT_5	0x0742
-#define FAN_TURBO_SUPPORTED	BIT(4)
-#define FAN_SUPPORT		BIT(5)
-#define CHARGIN_PRIO_SUPPORTED	BIT(5)	// TODO Conflict!
-
-#define EC_ADDR_CTGP_DB_CTRL	0x0743
-#define CTGP_DB_GENERAL_ENABLE	BIT(0)
-#define CTGP_DB_DB_ENABLE	BIT(1)
-#define CTGP_DB_CTGP_ENABLE	BIT(2)
-
-#define EC_ADDR_CTGP_OFFSET	0x0744
-
-#define EC_ADDR_TPP_OFFSET	0x0745
-
-#define EC_ADDR_MAX_TGP		0x0746
+#include "uniwill-laptop.h"
+#include "uniwill-telemetry.h"
+#include "uniwill-wmi.h"
 
-#define EC_ADDR_LIGHTBAR_CTRL	0x0748
-#define LIGHTBAR_POWER_SAFE	BIT(1)
-#define LIGHTBAR_S0_OFF		BIT(2)
-#define LIGHTBAR_S3_OFF		BIT(3)
-#define LIGHTBAR_RAINBOW	BIT(7)
+#define CREATE_TRACE_POINTS
+#include "uniwill-laptop-trace.h"
 
-#define EC_ADDR_LIGHTBAR_RED	0x0749
+#define DRIVER_NAME	"uniwill"
+#define UNIWILL_GUID	"ABBC0F6F-8EA1-11D1-00A0-C90629100000"
 
-#define EC_ADDR_LIGHTBAR_GREEN	0x074A
+#define PWM_MAX			200
 
-#define EC_ADDR_LIGHTBAR_BLUE	0x074B
+/*
+ * Large enough to hold the ACPI buffer object returned by UNIWILL_GET_SET_ULONG
+ * including its payload, bigger replies fall back to a dynamically allocated buffer.
+ */
+#define UNIWILL_EC_BUFFER_SIZE	(sizeof(union acpi_object) + 64)
 
-#define EC_ADDR_BIOS_OEM	0x074E
-#define FN_LOCK_STATUS		BIT(4)
+#define UNIWILL_LATENCY_BUCKETS	32
 
-#define EC_ADDR_MANUAL_FAN_CTRL	0x0751
-#define FAN_LEVEL_MASK		GENMASK(2, 0)
-#define FAN_MODE_TURBO		BIT(4)
-#define FAN_MODE_HIGH		BIT(5)
-#define FAN_MODE_BOOST		BIT(6)
-#define FAN_MODE_USER		BIT(7)
+#define UNIWILL_MAX_PENDING	4
 
-#define EC_ADDR_SUPPORT_1	0x0765
-#define AIRPLANE_MODE		BIT(0)
-#define GPS_SWITCH		BIT(1)
-#define OVERCLOCK		BIT(2)
-#define MACRO_KEY		BIT(3)
-#define SHORTCUT_KEY		BIT(4)
-#define SUPER_KEY_LOCK		BIT(5)
-#define LIGHTBAR		BIT(6)
-#define FAN_BOOST		BIT(7)	/* Seems to be unrelated to manual fan control */
+#define UNIWILL_TELEMETRY_RECORDS	64
 
-#define EC_ADDR_SUPPORT_2	0x0766
-#define SILENT_MODE		BIT(0)
-#define USB_CHARGING		BIT(1)
-#define SINGLE_ZONE_KBD		BIT(2)
-#define CHINA_MODE		BIT(5)
-#define MY_BATTERY		BIT(6)
+#define UNIWILL_UPDATE_INTERVAL_MIN	100
+#define UNIWILL_UPDATE_INTERVAL_MAX	60000
 
-#define EC_ADDR_TRIGGER		0x0767
-#define TRIGGER_SUPER_KEY_LOCK	BIT(0)
-#define TRIGGER_LIGHTBAR	BIT(1)
-#define TRIGGER_FAN_BOOST	BIT(2)
-#define TRIGGER_SILENT_MODE	BIT(3)
-#define TRIGGER_USB_CHARGING	BIT(4)
-#define RGB_APPLY_COLOR		BIT(5)
-#define RGB_RAINBOW_EFFECT	BIT(7)
+#define UNIWILL_THERMAL_POLL_INTERVAL	1000
+#define UNIWILL_COOLING_STATES		FAN_CURVE_LENGTH
+#define UNIWILL_COOLING_PWM_MIN		(PWM_MAX / UNIWILL_COOLING_STATES)
 
-#define EC_ADDR_SWITCH_STATUS	0x0768
-#define SUPER_KEY_LOCK_STATUS	BIT(0)
-#define LIGHTBAR_STATUS		BIT(1)
-#define FAN_BOOST_STATUS	BIT(2)
+/* NVIDIA Dynamic Boost shifts at most 25 Watt from the CPU to the GPU */
+#define UNIWILL_TPP_OFFSET_MAX		25
 
-#define EC_ADDR_RGB_RED		0x0769
+static unsigned int sample_interval;
+module_param(sample_interval, uint, 0444);
+MODULE_PARM_DESC(sample_interval,
+		 "Interval in milliseconds for sampling the sensors in the background (0 = disabled)");
 
-#define EC_ADDR_RGB_GREEN	0x076A
+static unsigned int sample_interval_max;
+module_param(sample_interval_max, uint, 0444);
+MODULE_PARM_DESC(sample_interval_max,
+		 "Maximum interval in milliseconds when backing off while the sensors are stable (0 = no backoff)");
 
-#define EC_ADDR_RGB_BLUE	0x076B
+static unsigned int sample_temp_threshold = 1;
+module_param(sample_temp_threshold, uint, 0444);
+MODULE_PARM_DESC(sample_temp_threshold,
+		 "Temperature change in degree Celsius which resets the sampling interval");
 
-#define EC_ADDR_ROMID_START	0x0770
-#define ROMID_LENGTH		14
+static unsigned int sample_fan_threshold = 100;
+module_param(sample_fan_threshold, uint, 0444);
+MODULE_PARM_DESC(sample_fan_threshold, "Fan speed change in RPM which resets the sampling interval");
 
-#define EC_ADDR_ROMID_EXTRA_1	0x077E
+static unsigned int write_coalesce_delay;
+module_param(write_coalesce_delay, uint, 0444);
+MODULE_PARM_DESC(write_coalesce_delay,
+		 "Time in milliseconds during which configuration updates are merged before being written (0 = disabled)");
 
-#define EC_ADDR_ROMID_EXTRA_2	0x077F
+static unsigned int fan_control_interval = 1000;
+module_param(fan_control_interval, uint, 0444);
+MODULE_PARM_DESC(fan_control_interval, "Interval in milliseconds of the in-kernel fan control loop");
 
-#define EC_ADDR_BIOS_OEM_2	0x0782
-#define FAN_V2_NEW		BIT(0)
-#define FAN_QKEY		BIT(1)
-#define FAN_TABLE_OFFICE_MODE	BIT(2)
-#define FAN_V3			BIT(3)
-#define DEFAULT_MODE		BIT(4)
+static unsigned int fan_control_hysteresis = 3;
+module_param(fan_control_hysteresis, uint, 0444);
+MODULE_PARM_DESC(fan_control_hysteresis,
+		 "Temperature drop in degree Celsius required before the fans are slowed down");
 
-#define EC_ADDR_PL1_SETTING	0x0783
+static unsigned int fan_control_step = 12;
+module_param(fan_control_step, uint, 0444);
+MODULE_PARM_DESC(fan_control_step,
+		 "Maximum change of the PWM duty cycle (1-255) per fan control iteration");
 
-#define EC_ADDR_PL2_SETTING	0x0784
+enum uniwill_method {
+	UNIWILL_GET_ULONG	= 0x01,
+	UNIWILL_SET_ULONG	= 0x02,
+	UNIWILL_FIRE_ULONG	= 0x03,
+	UNIWILL_GET_SET_ULONG	= 0x04,
+	UNIWILL_GET_BUTTON	= 0x05,
+};
 
-#define EC_ADDR_PL4_SETTING	0x0785
+struct uniwill_thermal {
+	struct uniwill_data *data;
+	struct thermal_zone_device *tzd;
+	struct thermal_cooling_device *cdev;
+	unsigned int channel;
+};
 
-#define EC_ADDR_FAN_DEFAULT	0x0786
-#define FAN_CURVE_LENGTH	5
+/* The features after UNIWILL_FEATURE_SILENT_MODE are detected by reading their registers */
+enum uniwill_feature {
+	UNIWILL_FEATURE_SILENT_MODE,
+	UNIWILL_FEATURE_DYNAMIC_BOOST,
+	UNIWILL_FEATURE_CTGP,
+	UNIWILL_FEATURE_TPP,
+	UNIWILL_FEATURE_OEM_3,
+	UNIWILL_FEATURE_COUNT
+};
 
-#define EC_ADDR_KBD_STATUS	0x078C
-#define KBD_WHITE_ONLY		BIT(0)	// ~single color
-#define KBD_SINGLE_COLOR_OFF	BIT(1)
-#define KBD_TURBO_LEVEL_MASK	GENMASK(3, 2)
-#define KBD_APPLY		BIT(4)
-#define KBD_BRIGHTNESS		GENMASK(7, 5)
+/*
+ * Describes a power limit register. The bits in ctrl_mask are set inside
+ * EC_ADDR_CTGP_DB_CTRL when the limit is changed.
+ */
+struct uniwill_limit {
+	const char *display_name;
+	unsigned int reg;
+	unsigned int min;
+	unsigned int max;
+	unsigned int ctrl_mask;
+};
 
-#define EC_ADDR_FAN_CTRL	0x078E
-#define FAN3P5			BIT(1)
-#define CHARGING_PROFILE	BIT(3)
-#define UNIVERSAL_FAN_CTRL	BIT(6)
+struct uniwill_limit_range {
+	unsigned int default_value;
+	unsigned int max_value;
+};
 
-#define EC_ADDR_BIOS_OEM_3	0x07A3
-#define FAN_REDUCED_DURY_CYCLE	BIT(5)
-#define FAN_ALWAYS_ON		BIT(6)
+struct uniwill_limit_attribute {
+	struct device_attribute dev_attr;
+	enum uniwill_limit_index index;
+};
 
-#define EC_ADDR_BIOS_BYTE	0x07A4
-#define FN_LOCK_SWITCH		BIT(3)
+#define to_uniwill_limit_attr(_attr)	\
+	container_of(_attr, struct uniwill_limit_attribute, dev_attr)
 
-#define EC_ADDR_OEM_3		0x07A5
-#define POWER_LED_MASK		GENMASK(1, 0)
-#define POWER_LED_LEFT		0x00
-#define POWER_LED_BOTH		0x01
-#define POWER_LED_NONE		0x02
-#define FAN_QUIET		BIT(2)
-#define OVERBOOST		BIT(4)
-#define HIGH_POWER		BIT(7)
+enum uniwill_profile_index {
+	UNIWILL_PROFILE_LOW_POWER,
+	UNIWILL_PROFILE_QUIET,
+	UNIWILL_PROFILE_BALANCED,
+	UNIWILL_PROFILE_BALANCED_PERFORMANCE,
+	UNIWILL_PROFILE_PERFORMANCE,
+	UNIWILL_PROFILE_COUNT
+};
 
-#define EC_ADDR_OEM_4		0x07A6
-#define OVERBOOST_DYN_TEMP_OFF	BIT(1)
-#define TOUCHPAD_TOGGLE_OFF	BIT(6)
-// TODO
-
-#define EC_ADDR_CHARGE_CTRL	0x07B9
-#define CHARGE_CTRL_MASK	GEMASK(6, 0)
-#define CHARGE_CTRL_REACHED	BIT(7)
-
-#define EC_ADDR_CHARGE_PRIO	0x07CC
-#define CHARGING_PERFORMANCE	BIT(7)
+/* Power settings programmed together with the fan mode of a platform profile */
+struct uniwill_bundle {
+	unsigned int limits[UNIWILL_LIMIT_COUNT];
+	unsigned int oem_3;	/* OVERBOOST and FAN_QUIET bits */
+};
 
-#define EC_ADDR_PWM_1		0x1804
+/* The index is a limit or an EC_ADDR_OEM_3 bit, depending on the attribute */
+struct uniwill_bundle_attribute {
+	struct device_attribute dev_attr;
+	enum uniwill_profile_index profile;
+	unsigned int index;
+};
 
-#define EC_ADDR_PWM_2		0x1809
+#define to_uniwill_bundle_attr(_attr)	\
+	container_of(_attr, struct uniwill_bundle_attribute, dev_attr)
 
-#define DRIVER_NAME	"uniwill"
-#define UNIWILL_GUID	"ABBC0F6F-8EA1-11D1-00A0-C90629100000"
+struct uniwill_reg_stats {
+	u64 reads;
+	u64 writes;
+	u64 errors;
+};
 
-#define PWM_MAX			200
+static const int uniwill_ec_errors[] = {
+	EIO,
+	ENODATA,
+	ENOMSG,
+	EPROTO,
+	ENXIO,
+};
 
-enum uniwill_method {
-	UNIWILL_GET_ULONG	= 0x01,
-	UNIWILL_SET_ULONG	= 0x02,
-	UNIWILL_FIRE_ULONG	= 0x03,
-	UNIWILL_GET_SET_ULONG	= 0x04,
-	UNIWILL_GET_BUTTON	= 0x05,
+struct uniwill_telemetry {
+	struct miscdevice misc;
+	int id;
+	struct uniwill_telemetry_page *page;
+	struct kref kref;
+	spinlock_t lock;	/* Protects readers and dead */
+	struct list_head readers;
+	wait_queue_head_t wait;
+	bool dead;
 };
 
-struct uniwill_method_buffer {
-	__le16 address;
-	__le16 data;
-	__le16 operation;
-	__le16 reserved;
-} __packed;
+struct uniwill_telemetry_reader {
+	struct list_head list;
+	struct uniwill_telemetry *telemetry;
+	struct mutex lock;	/* Serializes consumers of records */
+	DECLARE_KFIFO(records, struct uniwill_telemetry_record, UNIWILL_TELEMETRY_RECORDS);
+};
 
 struct uniwill_data {
 	struct wmi_device *wdev;
 	struct regmap *regmap;
+	struct mutex ec_lock;	/* Protects ec_buffer during EC accesses */
+	u8 ec_buffer[UNIWILL_EC_BUFFER_SIZE] __aligned(sizeof(u64));
+	bool ec_wide_read;
+	DECLARE_BITMAP(features, UNIWILL_FEATURE_COUNT);
+	struct mutex stats_lock;	/* Protects the EC statistics below */
+	struct xarray reg_stats;
+	u64 ec_errors[ARRAY_SIZE(uniwill_ec_errors)];
+	u64 ec_latency[UNIWILL_LATENCY_BUCKETS];
+	u64 cache_misses;
+	u64 skipped_writes;
+	struct mutex pending_lock;	/* Protects the pending writes */
+	struct uniwill_pending_write pending[UNIWILL_MAX_PENDING];
+	unsigned int pending_count;
+	unsigned int coalesce_delay;
+	struct delayed_work flush_work;
+	struct delayed_work sample_work;
+	unsigned int sample_interval;
+	unsigned int sample_interval_max;
+	unsigned int sample_delay;
+	seqlock_t sensor_lock;	/* Protects sensors, sensors_valid and the temperature history */
+	struct uniwill_sensors sensors;
+	bool sensors_valid;
+	unsigned int temp_lowest[UNIWILL_CHANNELS];
+	unsigned int temp_highest[UNIWILL_CHANNELS];
+	bool history_valid[UNIWILL_CHANNELS];
+	struct uniwill_telemetry *telemetry;
+	struct mutex curve_lock;	/* Protects the fan curve and the fan control modes */
+	u8 curve_pwm[FAN_CURVE_LENGTH];
+	struct delayed_work control_work;
+	bool fan_control;
+	bool thermal_control;
+	struct uniwill_thermal thermal[UNIWILL_CHANNELS];
+	struct mutex limit_lock;	/* Serializes changes of the power limits */
+	struct uniwill_limit_range limits[UNIWILL_LIMIT_COUNT];
+	bool dynamic_boost_default;
+	struct mutex profile_lock;	/* Protects the bundles and serializes profile changes */
+	struct uniwill_bundle bundles[UNIWILL_PROFILE_COUNT];
+	enum uniwill_profile_index profile;
+	bool profile_valid;
+	int supply_profiles[2];	/* Indexed by BAT_DISCHARGING, -1 if disabled */
 	struct platform_profile_handler profile_handler;
 	struct notifier_block notifier;
 };
@@ -235,91 +293,264 @@ static const char * const uniwill_fan_labels[] = {
 	"Secondary",
 };
 
-static int uniwill_get_set_ulong(struct wmi_device *wdev, struct uniwill_method_buffer *input,
-				 u32 *output)
+static const unsigned int uniwill_temp_regs[UNIWILL_CHANNELS] = {
+	EC_ADDR_CPU_TEMP,
+	EC_ADDR_GPU_TEMP,
+};
+
+static const unsigned int uniwill_fan_regs[UNIWILL_CHANNELS] = {
+	EC_ADDR_MAIN_FAN_RPM_1,
+	EC_ADDR_SECOND_FAN_RPM_1,
+};
+
+static const unsigned int uniwill_pwm_regs[UNIWILL_CHANNELS] = {
+	EC_ADDR_PWM_1,
+	EC_ADDR_PWM_2,
+};
+
+VISIBLE_IF_KUNIT int uniwill_parse_reply(const struct acpi_buffer *out, u32 *output)
+{
+	const union acpi_object *obj = out->pointer;
+
+	if (!obj || !out->length)
+		return -ENODATA;
+
+	if (obj->type != ACPI_TYPE_BUFFER)
+		return -ENOMSG;
+
+	if (obj->buffer.length < sizeof(*output))
+		return -EPROTO;
+
+	*output = get_unaligned_le32(obj->buffer.pointer);
+
+	return 0;
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_parse_reply);
+
+/* The KUnit tests redirect this to a fake EC, which keeps the regmap bus in the test path */
+VISIBLE_IF_KUNIT int uniwill_get_set_ulong(struct uniwill_data *data,
+					   struct uniwill_method_buffer *input, u32 *output)
 {
-	struct acpi_buffer out = { ACPI_ALLOCATE_BUFFER, NULL };
+	struct acpi_buffer out = {
+		.length = sizeof(data->ec_buffer),
+		.pointer = data->ec_buffer,
+	};
 	struct acpi_buffer in = {
 		.length = sizeof(*input),
 		.pointer = input,
 	};
-	union acpi_object *obj;
 	acpi_status status;
-	int ret = 0;
+	int ret;
 
-	status = wmidev_evaluate_method(wdev, 0x0, UNIWILL_GET_SET_ULONG, &in, &out);
-	if (ACPI_FAILURE(status))
-		return -EIO;
+	KUNIT_STATIC_STUB_REDIRECT(uniwill_get_set_ulong, data, input, output);
 
-	obj = out.pointer;
-	if (!obj)
-		return -ENODATA;
+	mutex_lock(&data->ec_lock);
 
-	if (obj->type != ACPI_TYPE_BUFFER) {
-		ret = -ENOMSG;
-		goto free_obj;
+	status = wmidev_evaluate_method(data->wdev, 0x0, UNIWILL_GET_SET_ULONG, &in, &out);
+	if (status == AE_BUFFER_OVERFLOW) {
+		/*
+		 * The method was already executed, so repeating it is safe since
+		 * EC RAM accesses are idempotent.
+		 */
+		dev_warn_once(&data->wdev->dev, "EC reply too large, using dynamic buffer\n");
+
+		out.length = ACPI_ALLOCATE_BUFFER;
+		out.pointer = NULL;
+		status = wmidev_evaluate_method(data->wdev, 0x0, UNIWILL_GET_SET_ULONG, &in,
+						&out);
 	}
 
-	if (obj->buffer.length < sizeof(*output)) {
-		ret = -EPROTO;
-		goto free_obj;
+	if (ACPI_FAILURE(status)) {
+		ret = -EIO;
+		goto out_unlock;
 	}
 
-	*output = get_unaligned_le32(obj->buffer.pointer);
+	ret = uniwill_parse_reply(&out, output);
 
-free_obj:
-	kfree(obj);
+	if (out.pointer != data->ec_buffer)
+		kfree(out.pointer);
+
+out_unlock:
+	mutex_unlock(&data->ec_lock);
 
 	return ret;
 }
+EXPORT_SYMBOL_IF_KUNIT(uniwill_get_set_ulong);
+
+static bool uniwill_volatile_reg(struct device *dev, unsigned int reg);
+
+static struct uniwill_reg_stats *uniwill_reg_stats_get(struct uniwill_data *data,
+						      unsigned int reg)
+{
+	struct uniwill_reg_stats *stats;
+
+	lockdep_assert_held(&data->stats_lock);
+
+	stats = xa_load(&data->reg_stats, reg);
+	if (!stats) {
+		/* Only happens during the first access to each register */
+		stats = kzalloc(sizeof(*stats), GFP_KERNEL);
+		if (stats && xa_is_err(xa_store(&data->reg_stats, reg, stats, GFP_KERNEL))) {
+			kfree(stats);
+			stats = NULL;
+		}
+	}
+
+	return stats;
+}
+
+/*
+ * The register counters are updated for every register returned by a wide
+ * read, while the error and latency counters are per WMI call.
+ */
+static void uniwill_ec_account(struct uniwill_data *data, unsigned int reg, unsigned int count,
+			       bool write, int ret, u64 duration)
+{
+	struct uniwill_reg_stats *stats;
+	unsigned int i;
+
+	mutex_lock(&data->stats_lock);
+
+	for (i = 0; i < count; i++) {
+		stats = uniwill_reg_stats_get(data, reg + i);
+		if (stats) {
+			if (write)
+				stats->writes++;
+			else
+				stats->reads++;
+
+			if (ret < 0)
+				stats->errors++;
+		}
+
+		if (!write && !uniwill_volatile_reg(&data->wdev->dev, reg + i))
+			data->cache_misses++;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(uniwill_ec_errors); i++) {
+		if (ret == -uniwill_ec_errors[i])
+			data->ec_errors[i]++;
+	}
+
+	data->ec_latency[min(fls64(duration), UNIWILL_LATENCY_BUCKETS - 1)]++;
+
+	mutex_unlock(&data->stats_lock);
+}
 
-static int uniwill_ec_reg_write(void *context, unsigned int reg, unsigned int val)
+static int uniwill_ec_reg_write(struct uniwill_data *data, unsigned int reg, u8 val)
 {
 	struct uniwill_method_buffer input = {
 		.address = cpu_to_le16(reg),
-		.data = cpu_to_le16(val & U8_MAX),
+		.data = cpu_to_le16(val),
 		.operation = 0x0000,
 	};
-	struct uniwill_data *data = context;
+	u64 start = ktime_get_ns();
+	u64 duration;
 	u32 output;
 	int ret;
 
-	ret = uniwill_get_set_ulong(data->wdev, &input, &output);
-	if (ret < 0)
-		return ret;
+	ret = uniwill_get_set_ulong(data, &input, &output);
+	if (!ret && output == 0xFEFEFEFE)
+		ret = -ENXIO;
 
-	if (output == 0xFEFEFEFE)
-		return -ENXIO;
+	duration = ktime_get_ns() - start;
+	trace_uniwill_ec_write(reg, val, ret, duration);
+	uniwill_ec_account(data, reg, 1, true, ret, duration);
 
-	return 0;
+	return ret;
 }
 
-static int uniwill_ec_reg_read(void *context, unsigned int reg, unsigned int *val)
+/*
+ * Some firmware implementations return the contents of the following
+ * registers inside the upper bytes of the output, so up to four consecutive
+ * registers can be read at once when ec_wide_read is set. The caller passes
+ * the number of registers it takes from the output for the statistics.
+ */
+static int uniwill_ec_reg_read(struct uniwill_data *data, unsigned int reg, unsigned int count,
+			       u32 *val)
 {
 	struct uniwill_method_buffer input = {
 		.address = cpu_to_le16(reg),
 		.data = 0x0000,
 		.operation = cpu_to_le16(0x0100),
 	};
-	struct uniwill_data *data = context;
-	u32 output;
+	u64 start = ktime_get_ns();
+	u32 output = 0;
+	u64 duration;
 	int ret;
 
-	ret = uniwill_get_set_ulong(data->wdev, &input, &output);
+	ret = uniwill_get_set_ulong(data, &input, &output);
+	if (!ret && output == 0xFEFEFEFE)
+		ret = -ENXIO;
+
+	duration = ktime_get_ns() - start;
+	trace_uniwill_ec_read(reg, output, ret, duration);
+	uniwill_ec_account(data, reg, count, false, ret, duration);
+
 	if (ret < 0)
 		return ret;
 
-	if (output == 0xFEFEFEFE)
-		return -ENXIO;
+	*val = output;
+
+	return 0;
+}
+
+static int uniwill_ec_write(void *context, const void *buf, size_t count)
+{
+	struct uniwill_data *data = context;
+	const u8 *values = buf + sizeof(__le16);
+	unsigned int reg;
+	size_t i;
+	int ret;
+
+	if (count < sizeof(__le16))
+		return -EINVAL;
+
+	reg = get_unaligned_le16(buf);
+
+	for (i = 0; i < count - sizeof(__le16); i++) {
+		ret = uniwill_ec_reg_write(data, reg + i, values[i]);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int uniwill_ec_read(void *context, const void *reg_buf, size_t reg_size, void *val_buf,
+			   size_t val_size)
+{
+	struct uniwill_data *data = context;
+	unsigned int reg = get_unaligned_le16(reg_buf);
+	u8 *values = val_buf;
+	size_t count, i;
+	u32 output;
+	int ret;
+
+	while (val_size) {
+		if (data->ec_wide_read)
+			count = min(val_size, sizeof(output));
+		else
+			count = 1;
+
+		ret = uniwill_ec_reg_read(data, reg, count, &output);
+		if (ret < 0)
+			return ret;
 
-	*val = (u8)output;
+		for (i = 0; i < count; i++)
+			values[i] = (output >> (i * BITS_PER_BYTE)) & U8_MAX;
+
+		values += count;
+		reg += count;
+		val_size -= count;
+	}
 
 	return 0;
 }
 
 static const struct regmap_bus uniwill_ec_bus = {
-	.reg_write = uniwill_ec_reg_write,
-	.reg_read = uniwill_ec_reg_read,
+	.write = uniwill_ec_write,
+	.read = uniwill_ec_read,
 	.reg_format_endian_default = REGMAP_ENDIAN_LITTLE,
 	.val_format_endian_default = REGMAP_ENDIAN_LITTLE,
 };
@@ -328,7 +559,15 @@ static bool uniwill_writeable_reg(struct device *dev, unsigned int reg)
 {
 	switch (reg) {
 	case EC_ADDR_AP_OEM:
+	case EC_ADDR_CTGP_DB_CTRL:
+	case EC_ADDR_CTGP_OFFSET:
+	case EC_ADDR_TPP_OFFSET:
 	case EC_ADDR_MANUAL_FAN_CTRL:
+	case EC_ADDR_PL1_SETTING:
+	case EC_ADDR_PL2_SETTING:
+	case EC_ADDR_PL4_SETTING:
+	case EC_ADDR_FAN_DEFAULT ... EC_ADDR_FAN_DEFAULT + FAN_CURVE_LENGTH - 1:
+	case EC_ADDR_OEM_3:
 	case EC_ADDR_PWM_1:
 	case EC_ADDR_PWM_2:
 		return true;
@@ -340,6 +579,7 @@ static bool uniwill_writeable_reg(struct device *dev, unsigned int reg)
 static bool uniwill_readable_reg(struct device *dev, unsigned int reg)
 {
 	switch (reg) {
+	case EC_ADDR_BAT_STATUS:
 	case EC_ADDR_CPU_TEMP:
 	case EC_ADDR_GPU_TEMP:
 	case EC_ADDR_MAIN_FAN_RPM_1:
@@ -348,8 +588,18 @@ static bool uniwill_readable_reg(struct device *dev, unsigned int reg)
 	case EC_ADDR_SECOND_FAN_RPM_2:
 	case EC_ADDR_PROJECT_ID:
 	case EC_ADDR_AP_OEM:
+	case EC_ADDR_CTGP_DB_CTRL:
+	case EC_ADDR_CTGP_OFFSET:
+	case EC_ADDR_TPP_OFFSET:
 	case EC_ADDR_MANUAL_FAN_CTRL:
 	case EC_ADDR_SUPPORT_1:
+	case EC_ADDR_SUPPORT_2:
+	case EC_ADDR_ROMID_START ... EC_ADDR_ROMID_START + ROMID_LENGTH - 1:
+	case EC_ADDR_PL1_SETTING:
+	case EC_ADDR_PL2_SETTING:
+	case EC_ADDR_PL4_SETTING:
+	case EC_ADDR_FAN_DEFAULT ... EC_ADDR_FAN_DEFAULT + FAN_CURVE_LENGTH - 1:
+	case EC_ADDR_OEM_3:
 	case EC_ADDR_PWM_1:
 	case EC_ADDR_PWM_2:
 		return true;
@@ -361,6 +611,7 @@ static bool uniwill_readable_reg(struct device *dev, unsigned int reg)
 static bool uniwill_volatile_reg(struct device *dev, unsigned int reg)
 {
 	switch (reg) {
+	case EC_ADDR_BAT_STATUS:
 	case EC_ADDR_CPU_TEMP:
 	case EC_ADDR_GPU_TEMP:
 	case EC_ADDR_MAIN_FAN_RPM_1:
@@ -381,171 +632,1277 @@ static const struct regmap_config uniwill_ec_config = {
 	.volatile_reg = uniwill_volatile_reg,
 	.can_sleep = true,
 	.cache_type = REGCACHE_MAPLE,
-	.use_single_read = true,
 	.use_single_write = true,
 };
 
-static umode_t uniwill_is_visible(const void *drvdata, enum hwmon_sensor_types type, u32 attr,
-				  int channel)
+static int __uniwill_flush_writes(struct uniwill_data *data)
 {
-	switch (type) {
-	case hwmon_temp:
-		return 0444;
-	case hwmon_fan:
-		return 0444;
-	case hwmon_pwm:
-		return 0644;
-	default:
-		return 0;
+	struct uniwill_pending_write *pending;
+	unsigned int i;
+	int ret = 0;
+	int err;
+
+	lockdep_assert_held(&data->pending_lock);
+
+	/* Preserve the order in which the registers were first modified */
+	for (i = 0; i < data->pending_count; i++) {
+		pending = &data->pending[i];
+
+		err = regmap_update_bits(data->regmap, pending->reg, pending->mask, pending->value);
+		if (err < 0 && !ret)
+			ret = err;
 	}
+
+	data->pending_count = 0;
+
+	return ret;
 }
 
-static int uniwill_read(struct device *dev, enum hwmon_sensor_types type, u32 attr, int channel,
-			long *val)
+/* Removes the pending update of a register which is about to be written anyway */
+static bool uniwill_take_pending(struct uniwill_data *data, unsigned int reg,
+				 struct uniwill_pending_write *write)
 {
-	struct uniwill_data *data = dev_get_drvdata(dev);
-	unsigned int value;
-	__be16 rpm;
-	int ret;
+	unsigned int i;
 
-	switch (type) {
-	case hwmon_temp:
-		switch (channel) {
-		case 0:
-			ret = regmap_read(data->regmap, EC_ADDR_CPU_TEMP, &value);
-			break;
-		case 1:
-			ret = regmap_read(data->regmap, EC_ADDR_GPU_TEMP, &value);
-			break;
-		default:
-			return -EOPNOTSUPP;
-		}
+	lockdep_assert_held(&data->pending_lock);
 
-		if (ret < 0)
-			return ret;
+	for (i = 0; i < data->pending_count; i++) {
+		if (data->pending[i].reg != reg)
+			continue;
 
-		*val = value * 1000;
-		return 0;
-	case hwmon_fan:
-		switch (channel) {
-		case 0:
-			ret = regmap_bulk_read(data->regmap, EC_ADDR_MAIN_FAN_RPM_1, &rpm,
-					       sizeof(rpm));
-			break;
-		case 1:
-			ret = regmap_bulk_read(data->regmap, EC_ADDR_SECOND_FAN_RPM_1, &rpm,
-					       sizeof(rpm));
-			break;
-		default:
-			return -EOPNOTSUPP;
-		}
+		*write = data->pending[i];
+		data->pending_count--;
+		memmove(&data->pending[i], &data->pending[i + 1],
+			(data->pending_count - i) * sizeof(*data->pending));
 
-		if (ret < 0)
-			return ret;
+		return true;
+	}
 
-		*val = be16_to_cpu(rpm);
-		return 0;
-	case hwmon_pwm:
-		switch (attr) {
-		case hwmon_pwm_input:
-			switch (channel) {
-			case 0:
-				ret = regmap_read(data->regmap, EC_ADDR_PWM_1, &value);
-				break;
-			case 1:
-				ret = regmap_read(data->regmap, EC_ADDR_PWM_2, &value);
-				break;
-			default:
-				return -EOPNOTSUPP;
-			}
+	return false;
+}
 
-			*val = fixp_linear_interpolate(0, 0, PWM_MAX, U8_MAX, value);
-			return 0;
-		case hwmon_pwm_enable:
-			ret = regmap_read(data->regmap, EC_ADDR_MANUAL_FAN_CTRL, &value);
-			if (ret < 0)
-				return ret;
+VISIBLE_IF_KUNIT int uniwill_flush_writes(struct uniwill_data *data)
+{
+	int ret;
 
-			if (value & FAN_MODE_BOOST)
-				*val = 1;
-			else
-				*val = 2;
+	mutex_lock(&data->pending_lock);
+	ret = __uniwill_flush_writes(data);
+	mutex_unlock(&data->pending_lock);
 
-			return 0;
-		default:
-			return -EOPNOTSUPP;
-		}
-	default:
-		return -EOPNOTSUPP;
-	}
+	return ret;
 }
+EXPORT_SYMBOL_IF_KUNIT(uniwill_flush_writes);
 
-static int uniwill_read_string(struct device *dev, enum hwmon_sensor_types type, u32 attr,
-			       int channel, const char **str)
+static void uniwill_flush_work(struct work_struct *work)
 {
-	switch (type) {
-	case hwmon_temp:
-		*str = uniwill_temp_labels[channel];
-		return 0;
-	case hwmon_fan:
-		*str = uniwill_fan_labels[channel];
-		return 0;
-	default:
-		return -EOPNOTSUPP;
-	}
+	struct uniwill_data *data = container_of(to_delayed_work(work), struct uniwill_data,
+						 flush_work);
+	int ret;
+
+	mutex_lock(&data->pending_lock);
+
+	ret = __uniwill_flush_writes(data);
+	if (ret < 0)
+		dev_err(&data->wdev->dev, "Failed to write back configuration changes: %d\n", ret);
+
+	mutex_unlock(&data->pending_lock);
 }
 
-static int uniwill_write(struct device *dev, enum hwmon_sensor_types type, u32 attr, int channel,
-			 long val)
+/*
+ * Updates of non-volatile registers are merged and written back once after
+ * write_coalesce_delay, so that bursts of configuration changes only result
+ * in a single EC write per register. A failed write back is only logged,
+ * since the caller of the original update already returned.
+ */
+VISIBLE_IF_KUNIT int uniwill_update_bits(struct uniwill_data *data, unsigned int reg,
+					 unsigned int mask, unsigned int value)
 {
-	struct uniwill_data *data = dev_get_drvdata(dev);
-	unsigned int value;
+	struct uniwill_pending_write *pending = NULL;
+	unsigned int i;
+	int ret = 0;
 
-	switch (type) {
-	case hwmon_pwm:
-		switch (attr) {
-		case hwmon_pwm_input:
-			value = fixp_linear_interpolate(0, 0, U8_MAX, PWM_MAX,
-							clamp_val(val, 0, U8_MAX));
-			switch (channel) {
-			case 0:
-				return regmap_write(data->regmap, EC_ADDR_PWM_1, value);
-			case 1:
-				return regmap_write(data->regmap, EC_ADDR_PWM_2, value);
-			default:
-				return -EOPNOTSUPP;
-			}
-		case hwmon_pwm_enable:
-			switch (val) {
-			case 1:
-				return regmap_update_bits(data->regmap, EC_ADDR_MANUAL_FAN_CTRL,
-							  FAN_MODE_BOOST, FAN_MODE_BOOST);
-			case 2:
-				return regmap_update_bits(data->regmap, EC_ADDR_MANUAL_FAN_CTRL,
-							  FAN_MODE_BOOST, 0);
-			default:
-				return -EOPNOTSUPP;
-			}
-		default:
-			return -EOPNOTSUPP;
+	if (!data->coalesce_delay)
+		return regmap_update_bits(data->regmap, reg, mask, value);
+
+	mutex_lock(&data->pending_lock);
+
+	for (i = 0; i < data->pending_count; i++) {
+		if (data->pending[i].reg == reg) {
+			pending = &data->pending[i];
+			break;
 		}
-	default:
-		return -EOPNOTSUPP;
 	}
-}
-
-static const struct hwmon_ops uniwill_ops = {
-	.is_visible = uniwill_is_visible,
-	.read = uniwill_read,
-	.read_string = uniwill_read_string,
-	.write = uniwill_write,
-};
+
+	if (!pending) {
+		if (data->pending_count == UNIWILL_MAX_PENDING) {
+			ret = __uniwill_flush_writes(data);
+			if (ret < 0)
+				goto out_unlock;
+		}
+
+		pending = &data->pending[data->pending_count++];
+		pending->reg = reg;
+		pending->mask = 0;
+		pending->value = 0;
+	}
+
+	pending->mask |= mask;
+	pending->value = (pending->value & ~mask) | (value & mask);
+
+	schedule_delayed_work(&data->flush_work, msecs_to_jiffies(data->coalesce_delay));
+
+out_unlock:
+	mutex_unlock(&data->pending_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_update_bits);
+
+VISIBLE_IF_KUNIT int uniwill_read_reg(struct uniwill_data *data, unsigned int reg,
+				      unsigned int *value)
+{
+	unsigned int i;
+	int ret;
+
+	mutex_lock(&data->pending_lock);
+
+	ret = regmap_read(data->regmap, reg, value);
+	if (ret < 0)
+		goto out_unlock;
+
+	/* Take pending updates into account */
+	for (i = 0; i < data->pending_count; i++) {
+		if (data->pending[i].reg == reg)
+			*value = (*value & ~data->pending[i].mask) | data->pending[i].value;
+	}
+
+out_unlock:
+	mutex_unlock(&data->pending_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_read_reg);
+
+/*
+ * Writes to non-volatile registers are skipped when the EC already
+ * holds the desired value. Pending updates of other registers are
+ * written first, since direct writes like PWM values depend on the
+ * fan mode being set.
+ */
+VISIBLE_IF_KUNIT int uniwill_write_reg(struct uniwill_data *data, unsigned int reg,
+				       unsigned int value)
+{
+	struct uniwill_pending_write pending;
+	bool changed = true;
+	int ret;
+
+	mutex_lock(&data->pending_lock);
+
+	/* The whole register is replaced anyway */
+	uniwill_take_pending(data, reg, &pending);
+
+	ret = __uniwill_flush_writes(data);
+	if (ret < 0)
+		goto out_unlock;
+
+	if (uniwill_volatile_reg(&data->wdev->dev, reg)) {
+		ret = regmap_write(data->regmap, reg, value);
+		goto out_unlock;
+	}
+
+	ret = regmap_update_bits_check(data->regmap, reg, GENMASK(7, 0), value, &changed);
+
+out_unlock:
+	mutex_unlock(&data->pending_lock);
+
+	if (ret < 0)
+		return ret;
+
+	if (!changed) {
+		mutex_lock(&data->stats_lock);
+		data->skipped_writes++;
+		mutex_unlock(&data->stats_lock);
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_write_reg);
+
+/*
+ * Applies the writes in order and restores the previous register values
+ * if one of them fails. Pending updates of the same registers are merged
+ * into the writes, so that a register is only written once.
+ */
+VISIBLE_IF_KUNIT int uniwill_write_transaction(struct uniwill_data *data,
+					       const struct uniwill_pending_write *writes,
+					       unsigned int count, unsigned int *old)
+{
+	struct uniwill_pending_write merged[UNIWILL_MAX_PENDING];
+	unsigned int merged_count = 0;
+	unsigned int mask, value;
+	unsigned int i, j;
+	int ret, err;
+
+	mutex_lock(&data->pending_lock);
+
+	for (i = 0; i < count; i++) {
+		if (uniwill_take_pending(data, writes[i].reg, &merged[merged_count]))
+			merged_count++;
+	}
+
+	/* The other coalesced writes must not overwrite the transaction later */
+	ret = __uniwill_flush_writes(data);
+	if (ret < 0)
+		goto out_merged;
+
+	for (i = 0; i < count; i++) {
+		ret = regmap_read(data->regmap, writes[i].reg, &old[i]);
+		if (ret < 0)
+			goto out_merged;
+	}
+
+	for (i = 0; i < count; i++) {
+		mask = writes[i].mask;
+		value = writes[i].value & mask;
+
+		for (j = 0; j < merged_count; j++) {
+			if (merged[j].reg == writes[i].reg && merged[j].mask) {
+				value |= merged[j].value & ~mask;
+				mask |= merged[j].mask;
+				merged[j].mask = 0;
+				break;
+			}
+		}
+
+		ret = regmap_update_bits(data->regmap, writes[i].reg, mask, value);
+		if (ret < 0)
+			break;
+	}
+
+	if (ret < 0) {
+		/* Only the bits of the transaction are restored, merged updates stay */
+		while (i--) {
+			if (regmap_update_bits(data->regmap, writes[i].reg, writes[i].mask,
+					       old[i]) < 0)
+				dev_err(&data->wdev->dev, "Failed to restore register 0x%04x\n",
+					writes[i].reg);
+		}
+	}
+
+out_merged:
+	/* Merged updates which were not reached are still written back */
+	for (j = 0; j < merged_count; j++) {
+		if (!merged[j].mask)
+			continue;
+
+		err = regmap_update_bits(data->regmap, merged[j].reg, merged[j].mask,
+					 merged[j].value);
+		if (err < 0)
+			dev_err(&data->wdev->dev,
+				"Failed to write back configuration changes: %d\n", err);
+	}
+
+	mutex_unlock(&data->pending_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_write_transaction);
+
+static void uniwill_flush_writes_action(void *context)
+{
+	uniwill_flush_writes(context);
+}
+
+static int uniwill_coalesce_init(struct uniwill_data *data, unsigned int coalesce_delay)
+{
+	struct device *dev = &data->wdev->dev;
+	int ret;
+
+	data->coalesce_delay = coalesce_delay;
+
+	ret = devm_mutex_init(dev, &data->pending_lock);
+	if (ret < 0)
+		return ret;
+
+	ret = devm_delayed_work_autocancel(dev, &data->flush_work, uniwill_flush_work);
+	if (ret < 0)
+		return ret;
+
+	return devm_add_action_or_reset(dev, uniwill_flush_writes_action, data);
+}
+
+static int uniwill_registers_show(struct seq_file *m, void *unused)
+{
+	struct uniwill_data *data = m->private;
+	struct uniwill_reg_stats *stats;
+	unsigned long reg;
+
+	seq_puts(m, "register\treads\twrites\terrors\n");
+
+	mutex_lock(&data->stats_lock);
+	xa_for_each(&data->reg_stats, reg, stats)
+		seq_printf(m, "0x%04lx\t%llu\t%llu\t%llu\n", reg, stats->reads, stats->writes,
+			   stats->errors);
+	mutex_unlock(&data->stats_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(uniwill_registers);
+
+static int uniwill_errors_show(struct seq_file *m, void *unused)
+{
+	struct uniwill_data *data = m->private;
+	unsigned int i;
+
+	mutex_lock(&data->stats_lock);
+	for (i = 0; i < ARRAY_SIZE(uniwill_ec_errors); i++)
+		seq_printf(m, "%pe\t%llu\n", ERR_PTR(-uniwill_ec_errors[i]), data->ec_errors[i]);
+	mutex_unlock(&data->stats_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(uniwill_errors);
+
+static int uniwill_latency_show(struct seq_file *m, void *unused)
+{
+	struct uniwill_data *data = m->private;
+	unsigned int i;
+
+	seq_puts(m, "latency (ns)\t\tcount\n");
+
+	mutex_lock(&data->stats_lock);
+	seq_printf(m, "0\t\t\t%llu\n", data->ec_latency[0]);
+	for (i = 1; i < UNIWILL_LATENCY_BUCKETS - 1; i++)
+		seq_printf(m, "%llu-%llu\t\t%llu\n", BIT_ULL(i - 1), BIT_ULL(i) - 1,
+			   data->ec_latency[i]);
+	seq_printf(m, ">= %llu\t\t%llu\n", BIT_ULL(i - 1), data->ec_latency[i]);
+	mutex_unlock(&data->stats_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(uniwill_latency);
+
+static int uniwill_cache_show(struct seq_file *m, void *unused)
+{
+	struct uniwill_data *data = m->private;
+
+	/*
+	 * Cache hits are invisible to us since they are handled by the regmap core,
+	 * use the regmap_reg_read_cache tracepoint to count them.
+	 */
+	mutex_lock(&data->stats_lock);
+	seq_printf(m, "misses\t%llu\n", data->cache_misses);
+	seq_printf(m, "skipped_writes\t%llu\n", data->skipped_writes);
+	mutex_unlock(&data->stats_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(uniwill_cache);
+
+static void uniwill_stats_remove(void *context)
+{
+	struct uniwill_data *data = context;
+	struct uniwill_reg_stats *stats;
+	unsigned long reg;
+
+	xa_for_each(&data->reg_stats, reg, stats)
+		kfree(stats);
+
+	xa_destroy(&data->reg_stats);
+}
+
+static void uniwill_debugfs_remove(void *context)
+{
+	struct dentry *dir = context;
+
+	debugfs_remove_recursive(dir);
+}
+
+static int uniwill_debugfs_init(struct uniwill_data *data)
+{
+	struct device *dev = &data->wdev->dev;
+	struct dentry *dir;
+	char name[64];
+	int ret;
+
+	ret = devm_mutex_init(dev, &data->stats_lock);
+	if (ret < 0)
+		return ret;
+
+	xa_init(&data->reg_stats);
+	ret = devm_add_action_or_reset(dev, uniwill_stats_remove, data);
+	if (ret < 0)
+		return ret;
+
+	snprintf(name, sizeof(name), "%s-%s", DRIVER_NAME, dev_name(dev));
+	dir = debugfs_create_dir(name, NULL);
+
+	debugfs_create_file("registers", 0444, dir, data, &uniwill_registers_fops);
+	debugfs_create_file("errors", 0444, dir, data, &uniwill_errors_fops);
+	debugfs_create_file("latency", 0444, dir, data, &uniwill_latency_fops);
+	debugfs_create_file("cache", 0444, dir, data, &uniwill_cache_fops);
+
+	return devm_add_action_or_reset(dev, uniwill_debugfs_remove, dir);
+}
+
+static umode_t uniwill_is_visible(const void *drvdata, enum hwmon_sensor_types type, u32 attr,
+				  int channel)
+{
+	const struct uniwill_data *data = drvdata;
+
+	switch (type) {
+	case hwmon_chip:
+		switch (attr) {
+		case hwmon_chip_update_interval:
+			/* Without the sampler every read accesses the EC */
+			if (data->sample_interval)
+				return 0644;
+
+			return 0;
+		case hwmon_chip_reset_history:
+			return 0200;
+		default:
+			return 0;
+		}
+	case hwmon_temp:
+		if (attr == hwmon_temp_reset_history)
+			return 0200;
+
+		return 0444;
+	case hwmon_fan:
+		return 0444;
+	case hwmon_pwm:
+		return 0644;
+	default:
+		return 0;
+	}
+}
+
+static int uniwill_read_fan_rpm(struct uniwill_data *data, int channel, unsigned int *value)
+{
+	__be16 rpm;
+	int ret;
+
+	ret = regmap_bulk_read(data->regmap, uniwill_fan_regs[channel], &rpm, sizeof(rpm));
+	if (ret < 0)
+		return ret;
+
+	*value = be16_to_cpu(rpm);
+
+	return 0;
+}
+
+static int uniwill_sample_sensors(struct uniwill_data *data, struct uniwill_sensors *sensors)
+{
+	int ret, i;
+
+	for (i = 0; i < UNIWILL_CHANNELS; i++) {
+		ret = regmap_read(data->regmap, uniwill_temp_regs[i], &sensors->temp[i]);
+		if (ret < 0)
+			return ret;
+
+		ret = uniwill_read_fan_rpm(data, i, &sensors->fan[i]);
+		if (ret < 0)
+			return ret;
+
+		ret = regmap_read(data->regmap, uniwill_pwm_regs[i], &sensors->pwm[i]);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static bool uniwill_get_snapshot(struct uniwill_data *data, struct uniwill_sensors *sensors)
+{
+	unsigned int seq;
+	bool valid;
+
+	do {
+		seq = read_seqbegin(&data->sensor_lock);
+		*sensors = data->sensors;
+		valid = data->sensors_valid;
+	} while (read_seqretry(&data->sensor_lock, seq));
+
+	return valid;
+}
+
+static void uniwill_invalidate_snapshot(struct uniwill_data *data)
+{
+	write_seqlock(&data->sensor_lock);
+	data->sensors_valid = false;
+	write_sequnlock(&data->sensor_lock);
+}
+
+VISIBLE_IF_KUNIT int uniwill_profile_get(struct uniwill_data *data,
+					 enum platform_profile_option *profile);
+
+static DEFINE_IDA(uniwill_telemetry_ida);
+
+static void uniwill_telemetry_free(struct kref *kref)
+{
+	struct uniwill_telemetry *telemetry = container_of(kref, struct uniwill_telemetry, kref);
+
+	/* Existing mappings hold their own reference to the page */
+	free_page((unsigned long)telemetry->page);
+	kfree(telemetry->misc.name);
+	kfree(telemetry);
+}
+
+VISIBLE_IF_KUNIT u8 uniwill_telemetry_profile(enum platform_profile_option profile)
+{
+	switch (profile) {
+	case PLATFORM_PROFILE_LOW_POWER:
+		return UNIWILL_TELEMETRY_PROFILE_LOW_POWER;
+	case PLATFORM_PROFILE_QUIET:
+		return UNIWILL_TELEMETRY_PROFILE_QUIET;
+	case PLATFORM_PROFILE_BALANCED:
+		return UNIWILL_TELEMETRY_PROFILE_BALANCED;
+	case PLATFORM_PROFILE_BALANCED_PERFORMANCE:
+		return UNIWILL_TELEMETRY_PROFILE_BALANCED_PERFORMANCE;
+	case PLATFORM_PROFILE_PERFORMANCE:
+		return UNIWILL_TELEMETRY_PROFILE_PERFORMANCE;
+	default:
+		return UNIWILL_TELEMETRY_PROFILE_UNKNOWN;
+	}
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_telemetry_profile);
+
+static void uniwill_telemetry_publish(struct uniwill_data *data,
+				      const struct uniwill_sensors *sensors)
+{
+	struct uniwill_telemetry *telemetry = data->telemetry;
+	struct uniwill_telemetry_record record = {
+		.timestamp = ktime_get_ns(),
+		.fan_rpm = { sensors->fan[0], sensors->fan[1] },
+		.cpu_temp = sensors->temp[0],
+		.gpu_temp = sensors->temp[1],
+		.profile = UNIWILL_TELEMETRY_PROFILE_UNKNOWN,
+	};
+	struct uniwill_telemetry_reader *reader;
+	struct uniwill_telemetry_page *page;
+	enum platform_profile_option profile;
+	int i;
+
+	if (!telemetry)
+		return;
+
+	for (i = 0; i < UNIWILL_CHANNELS; i++)
+		record.pwm[i] = fixp_linear_interpolate(0, 0, PWM_MAX, U8_MAX, sensors->pwm[i]);
+
+	/* Served from the regmap cache */
+	if (!uniwill_profile_get(data, &profile))
+		record.profile = uniwill_telemetry_profile(profile);
+
+	/* We are the only writer, so a plain sequence counter is enough */
+	page = telemetry->page;
+	WRITE_ONCE(page->sequence, page->sequence + 1);
+	smp_wmb();
+	page->latest = record;
+	smp_wmb();
+	WRITE_ONCE(page->sequence, page->sequence + 1);
+
+	if (list_empty(&telemetry->readers))
+		return;
+
+	spin_lock(&telemetry->lock);
+	/* Slow readers miss the newest records */
+	list_for_each_entry(reader, &telemetry->readers, list)
+		kfifo_put(&reader->records, record);
+	spin_unlock(&telemetry->lock);
+
+	wake_up_interruptible(&telemetry->wait);
+}
+
+static int uniwill_telemetry_open(struct inode *inode, struct file *file)
+{
+	struct uniwill_telemetry *telemetry = container_of(file->private_data,
+							   struct uniwill_telemetry, misc);
+	struct uniwill_telemetry_reader *reader;
+
+	reader = kzalloc(sizeof(*reader), GFP_KERNEL);
+	if (!reader)
+		return -ENOMEM;
+
+	INIT_KFIFO(reader->records);
+	mutex_init(&reader->lock);
+	reader->telemetry = telemetry;
+
+	spin_lock(&telemetry->lock);
+	if (telemetry->dead) {
+		spin_unlock(&telemetry->lock);
+		kfree(reader);
+
+		return -ENODEV;
+	}
+
+	list_add_tail(&reader->list, &telemetry->readers);
+	kref_get(&telemetry->kref);
+	spin_unlock(&telemetry->lock);
+
+	file->private_data = reader;
+
+	return stream_open(inode, file);
+}
+
+static int uniwill_telemetry_release(struct inode *inode, struct file *file)
+{
+	struct uniwill_telemetry_reader *reader = file->private_data;
+	struct uniwill_telemetry *telemetry = reader->telemetry;
+
+	spin_lock(&telemetry->lock);
+	list_del(&reader->list);
+	spin_unlock(&telemetry->lock);
+
+	kref_put(&telemetry->kref, uniwill_telemetry_free);
+	mutex_destroy(&reader->lock);
+	kfree(reader);
+
+	return 0;
+}
+
+static bool uniwill_telemetry_readable(struct uniwill_telemetry_reader *reader)
+{
+	return !kfifo_is_empty(&reader->records) || READ_ONCE(reader->telemetry->dead);
+}
+
+static ssize_t uniwill_telemetry_read(struct file *file, char __user *buf, size_t count,
+				      loff_t *ppos)
+{
+	struct uniwill_telemetry_reader *reader = file->private_data;
+	struct uniwill_telemetry *telemetry = reader->telemetry;
+	struct uniwill_telemetry_record record;
+	size_t copied = 0;
+	int ret;
+
+	if (count < sizeof(record))
+		return -EINVAL;
+
+	while (true) {
+		mutex_lock(&reader->lock);
+		while (count - copied >= sizeof(record) && kfifo_get(&reader->records, &record)) {
+			if (copy_to_user(buf + copied, &record, sizeof(record))) {
+				mutex_unlock(&reader->lock);
+				return -EFAULT;
+			}
+
+			copied += sizeof(record);
+		}
+		mutex_unlock(&reader->lock);
+
+		/* Concurrent readers might have consumed the records we waited for */
+		if (copied)
+			return copied;
+
+		if (READ_ONCE(telemetry->dead))
+			return -ENODEV;
+
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(telemetry->wait, uniwill_telemetry_readable(reader));
+		if (ret < 0)
+			return ret;
+	}
+}
+
+static __poll_t uniwill_telemetry_poll(struct file *file, struct poll_table_struct *wait)
+{
+	struct uniwill_telemetry_reader *reader = file->private_data;
+	struct uniwill_telemetry *telemetry = reader->telemetry;
+	__poll_t mask = 0;
+
+	poll_wait(file, &telemetry->wait, wait);
+
+	if (!kfifo_is_empty(&reader->records))
+		mask |= EPOLLIN | EPOLLRDNORM;
+
+	if (READ_ONCE(telemetry->dead))
+		mask |= EPOLLHUP | EPOLLERR;
+
+	return mask;
+}
+
+static int uniwill_telemetry_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct uniwill_telemetry_reader *reader = file->private_data;
+	struct uniwill_telemetry *telemetry = reader->telemetry;
+
+	if (vma->vm_pgoff || vma_pages(vma) != 1)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vm_flags_clear(vma, VM_MAYWRITE);
+
+	return vm_insert_page(vma, vma->vm_start, virt_to_page(telemetry->page));
+}
+
+static const struct file_operations uniwill_telemetry_fops = {
+	.owner = THIS_MODULE,
+	.open = uniwill_telemetry_open,
+	.release = uniwill_telemetry_release,
+	.read = uniwill_telemetry_read,
+	.poll = uniwill_telemetry_poll,
+	.mmap = uniwill_telemetry_mmap,
+};
+
+static void uniwill_telemetry_remove(void *context)
+{
+	struct uniwill_data *data = context;
+	struct uniwill_telemetry *telemetry = data->telemetry;
+
+	misc_deregister(&telemetry->misc);
+	ida_free(&uniwill_telemetry_ida, telemetry->id);
+
+	/* Open files keep the telemetry alive, so wake up any waiting readers */
+	spin_lock(&telemetry->lock);
+	telemetry->dead = true;
+	spin_unlock(&telemetry->lock);
+	wake_up_interruptible(&telemetry->wait);
+
+	data->telemetry = NULL;
+	kref_put(&telemetry->kref, uniwill_telemetry_free);
+}
+
+static int uniwill_telemetry_init(struct uniwill_data *data)
+{
+	struct uniwill_telemetry *telemetry;
+	int ret;
+
+	telemetry = kzalloc(sizeof(*telemetry), GFP_KERNEL);
+	if (!telemetry)
+		return -ENOMEM;
+
+	telemetry->page = (void *)get_zeroed_page(GFP_KERNEL);
+	if (!telemetry->page) {
+		kfree(telemetry);
+		return -ENOMEM;
+	}
+
+	kref_init(&telemetry->kref);
+	spin_lock_init(&telemetry->lock);
+	INIT_LIST_HEAD(&telemetry->readers);
+	init_waitqueue_head(&telemetry->wait);
+
+	/* The driver supports multiple instances, so each one needs its own device */
+	telemetry->id = ida_alloc(&uniwill_telemetry_ida, GFP_KERNEL);
+	if (telemetry->id < 0) {
+		ret = telemetry->id;
+		kref_put(&telemetry->kref, uniwill_telemetry_free);
+		return ret;
+	}
+
+	telemetry->misc.name = kasprintf(GFP_KERNEL, DRIVER_NAME "-telemetry%d", telemetry->id);
+	if (!telemetry->misc.name) {
+		ida_free(&uniwill_telemetry_ida, telemetry->id);
+		kref_put(&telemetry->kref, uniwill_telemetry_free);
+		return -ENOMEM;
+	}
+
+	telemetry->misc.minor = MISC_DYNAMIC_MINOR;
+	telemetry->misc.fops = &uniwill_telemetry_fops;
+	telemetry->misc.parent = &data->wdev->dev;
+	telemetry->misc.mode = 0444;
+
+	ret = misc_register(&telemetry->misc);
+	if (ret < 0) {
+		ida_free(&uniwill_telemetry_ida, telemetry->id);
+		kref_put(&telemetry->kref, uniwill_telemetry_free);
+		return ret;
+	}
+
+	data->telemetry = telemetry;
+
+	return devm_add_action_or_reset(&data->wdev->dev, uniwill_telemetry_remove, data);
+}
+
+VISIBLE_IF_KUNIT bool uniwill_sensors_changed(const struct uniwill_sensors *old,
+					      const struct uniwill_sensors *new)
+{
+	int i;
+
+	for (i = 0; i < UNIWILL_CHANNELS; i++) {
+		if (abs_diff(old->temp[i], new->temp[i]) >= sample_temp_threshold)
+			return true;
+
+		if (abs_diff(old->fan[i], new->fan[i]) >= sample_fan_threshold)
+			return true;
+
+		if (old->pwm[i] != new->pwm[i])
+			return true;
+	}
+
+	return false;
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_sensors_changed);
+
+static void __uniwill_update_history(struct uniwill_data *data, int channel, unsigned int temp)
+{
+	if (!data->history_valid[channel]) {
+		data->temp_lowest[channel] = temp;
+		data->temp_highest[channel] = temp;
+		data->history_valid[channel] = true;
+	} else {
+		data->temp_lowest[channel] = min(data->temp_lowest[channel], temp);
+		data->temp_highest[channel] = max(data->temp_highest[channel], temp);
+	}
+}
+
+static void uniwill_update_history(struct uniwill_data *data, int channel, unsigned int temp)
+{
+	write_seqlock(&data->sensor_lock);
+	__uniwill_update_history(data, channel, temp);
+	write_sequnlock(&data->sensor_lock);
+}
+
+static int uniwill_get_history(struct uniwill_data *data, int channel, u32 attr,
+			       unsigned int *value)
+{
+	unsigned int seq;
+	bool valid;
+
+	do {
+		seq = read_seqbegin(&data->sensor_lock);
+		valid = data->history_valid[channel];
+		if (attr == hwmon_temp_lowest)
+			*value = data->temp_lowest[channel];
+		else
+			*value = data->temp_highest[channel];
+	} while (read_seqretry(&data->sensor_lock, seq));
+
+	if (!valid)
+		return -ENODATA;
+
+	return 0;
+}
+
+static void uniwill_reset_history(struct uniwill_data *data, int channel)
+{
+	write_seqlock(&data->sensor_lock);
+	data->history_valid[channel] = false;
+	write_sequnlock(&data->sensor_lock);
+}
+
+static void uniwill_thermal_update(struct uniwill_data *data)
+{
+	int i;
+
+	/* The EC has no temperature interrupts, so the zones are updated by the driver */
+	for (i = 0; i < UNIWILL_CHANNELS; i++)
+		thermal_zone_device_update(data->thermal[i].tzd, THERMAL_EVENT_TEMP_SAMPLE);
+}
+
+static void uniwill_sample_work(struct work_struct *work)
+{
+	struct uniwill_data *data = container_of(to_delayed_work(work), struct uniwill_data,
+						 sample_work);
+	unsigned int interval = READ_ONCE(data->sample_interval);
+	unsigned int interval_max = READ_ONCE(data->sample_interval_max);
+	struct uniwill_sensors sensors, old;
+	bool valid;
+	int ret, i;
+
+	valid = uniwill_get_snapshot(data, &old);
+
+	ret = uniwill_sample_sensors(data, &sensors);
+	if (ret < 0) {
+		/* Let the readers access the EC directly so that they can report the error */
+		dev_dbg(&data->wdev->dev, "Failed to sample sensors: %d\n", ret);
+		uniwill_invalidate_snapshot(data);
+		data->sample_delay = interval;
+	} else {
+		write_seqlock(&data->sensor_lock);
+		data->sensors = sensors;
+		data->sensors_valid = true;
+		for (i = 0; i < UNIWILL_CHANNELS; i++)
+			__uniwill_update_history(data, i, sensors.temp[i]);
+		write_sequnlock(&data->sensor_lock);
+
+		uniwill_telemetry_publish(data, &sensors);
+		uniwill_thermal_update(data);
+
+		/* Sample fast while the thermal situation changes, back off otherwise */
+		if (!valid || uniwill_sensors_changed(&old, &sensors))
+			data->sample_delay = interval;
+		else
+			data->sample_delay = clamp(data->sample_delay * 2, interval, interval_max);
+	}
+
+	schedule_delayed_work(&data->sample_work, msecs_to_jiffies(data->sample_delay));
+}
+
+static int uniwill_write_pwm(struct uniwill_data *data, int channel, unsigned int value)
+{
+	int ret;
+
+	ret = uniwill_write_reg(data, uniwill_pwm_regs[channel], value);
+	if (ret < 0)
+		return ret;
+
+	/* Avoid serving the old duty cycle until the next sample */
+	write_seqlock(&data->sensor_lock);
+	data->sensors.pwm[channel] = value;
+	write_sequnlock(&data->sensor_lock);
+
+	return 0;
+}
+
+VISIBLE_IF_KUNIT unsigned int uniwill_curve_lookup(const u8 *temps, const u8 *pwm,
+						   unsigned int temp)
+{
+	int i;
+
+	if (temp <= temps[0])
+		return pwm[0];
+
+	for (i = 1; i < FAN_CURVE_LENGTH; i++) {
+		if (temp < temps[i])
+			return fixp_linear_interpolate(temps[i - 1], pwm[i - 1], temps[i], pwm[i],
+						       temp);
+	}
+
+	return pwm[FAN_CURVE_LENGTH - 1];
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_curve_lookup);
+
+/*
+ * Returns the duty cycle the fan should move towards. The fan is only slowed
+ * down once the temperature dropped by more than hysteresis, and a falling
+ * temperature never speeds the fan up.
+ */
+VISIBLE_IF_KUNIT unsigned int uniwill_fan_target(const u8 *temps, const u8 *pwm,
+						 unsigned int temp, unsigned int value,
+						 unsigned int hysteresis)
+{
+	unsigned int target;
+
+	target = uniwill_curve_lookup(temps, pwm, temp);
+	if (target < value) {
+		target = max(target, uniwill_curve_lookup(temps, pwm, temp + hysteresis));
+		target = min(target, value);
+	}
+
+	return target;
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_fan_target);
+
+static int uniwill_fan_control(struct uniwill_data *data)
+{
+	unsigned int temp, target, value, step;
+	struct uniwill_sensors sensors;
+	u8 temps[FAN_CURVE_LENGTH];
+	int ret, i;
+
+	if (!uniwill_get_snapshot(data, &sensors)) {
+		for (i = 0; i < UNIWILL_CHANNELS; i++) {
+			ret = regmap_read(data->regmap, uniwill_temp_regs[i], &sensors.temp[i]);
+			if (ret < 0)
+				return ret;
+		}
+	}
+
+	temp = max(sensors.temp[0], sensors.temp[1]);
+	step = fixp_linear_interpolate(0, 0, U8_MAX, PWM_MAX,
+				       min_t(unsigned int, fan_control_step, U8_MAX));
+
+	/* Small steps would round down to zero and freeze the control loop */
+	step = max(step, 1U);
+
+	ret = regmap_bulk_read(data->regmap, EC_ADDR_FAN_DEFAULT, temps, sizeof(temps));
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < UNIWILL_CHANNELS; i++) {
+		ret = regmap_read(data->regmap, uniwill_pwm_regs[i], &value);
+		if (ret < 0)
+			return ret;
+
+		target = uniwill_fan_target(temps, data->curve_pwm, temp, value,
+					    fan_control_hysteresis);
+		target = clamp(target, value - min(value, step), value + step);
+		if (target == value)
+			continue;
+
+		ret = uniwill_write_pwm(data, i, target);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Besides the fan control loop, the control work polls the thermal zones while they
+ * control the fans and the sampler is disabled. The EC is not polled otherwise.
+ */
+static bool uniwill_control_active(struct uniwill_data *data)
+{
+	return data->fan_control || (data->thermal_control && !data->sample_interval);
+}
+
+static void uniwill_control_work(struct work_struct *work)
+{
+	struct uniwill_data *data = container_of(to_delayed_work(work), struct uniwill_data,
+						 control_work);
+	bool poll = false;
+	int ret;
+
+	mutex_lock(&data->curve_lock);
+
+	if (data->fan_control) {
+		ret = uniwill_fan_control(data);
+		if (ret < 0)
+			dev_dbg(&data->wdev->dev, "Failed to control fans: %d\n", ret);
+
+		schedule_delayed_work(&data->control_work, msecs_to_jiffies(fan_control_interval));
+	} else if (uniwill_control_active(data)) {
+		poll = true;
+		schedule_delayed_work(&data->control_work,
+				      msecs_to_jiffies(UNIWILL_THERMAL_POLL_INTERVAL));
+	}
+
+	mutex_unlock(&data->curve_lock);
+
+	/* The cooling devices take curve_lock themselves */
+	if (poll)
+		uniwill_thermal_update(data);
+}
+
+/*
+ * Besides the manual (1) and automatic (2) modes, the fans can be controlled
+ * by the fan control loop (3) or by the thermal framework (4).
+ */
+static int uniwill_set_fan_mode(struct uniwill_data *data, long mode)
+{
+	int ret;
+
+	mutex_lock(&data->curve_lock);
+
+	switch (mode) {
+	case 1:
+	case 3:
+	case 4:
+		ret = uniwill_update_bits(data, EC_ADDR_MANUAL_FAN_CTRL, FAN_MODE_BOOST,
+					  FAN_MODE_BOOST);
+		break;
+	case 2:
+		ret = uniwill_update_bits(data, EC_ADDR_MANUAL_FAN_CTRL, FAN_MODE_BOOST, 0);
+		break;
+	default:
+		ret = -EOPNOTSUPP;
+		break;
+	}
+
+	if (!ret) {
+		data->fan_control = (mode == 3);
+		data->thermal_control = (mode == 4);
+	}
+
+	mutex_unlock(&data->curve_lock);
+
+	if (ret < 0)
+		return ret;
+
+	if (uniwill_control_active(data))
+		mod_delayed_work(system_wq, &data->control_work, 0);
+	else
+		cancel_delayed_work_sync(&data->control_work);
+
+	return 0;
+}
+
+VISIBLE_IF_KUNIT int uniwill_read(struct device *dev, enum hwmon_sensor_types type, u32 attr,
+				  int channel, long *val)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	struct uniwill_sensors sensors;
+	unsigned int value;
+	bool cached;
+	int ret;
+
+	cached = uniwill_get_snapshot(data, &sensors);
+
+	switch (type) {
+	case hwmon_chip:
+		switch (attr) {
+		case hwmon_chip_update_interval:
+			*val = READ_ONCE(data->sample_interval);
+			return 0;
+		default:
+			return -EOPNOTSUPP;
+		}
+	case hwmon_temp:
+		switch (attr) {
+		case hwmon_temp_input:
+			if (cached) {
+				value = sensors.temp[channel];
+			} else {
+				ret = regmap_read(data->regmap, uniwill_temp_regs[channel], &value);
+				if (ret < 0)
+					return ret;
+
+				uniwill_update_history(data, channel, value);
+			}
+
+			*val = value * 1000;
+			return 0;
+		case hwmon_temp_lowest:
+		case hwmon_temp_highest:
+			ret = uniwill_get_history(data, channel, attr, &value);
+			if (ret < 0)
+				return ret;
+
+			*val = value * 1000;
+			return 0;
+		default:
+			return -EOPNOTSUPP;
+		}
+	case hwmon_fan:
+		if (cached) {
+			value = sensors.fan[channel];
+		} else {
+			ret = uniwill_read_fan_rpm(data, channel, &value);
+			if (ret < 0)
+				return ret;
+		}
+
+		*val = value;
+		return 0;
+	case hwmon_pwm:
+		switch (attr) {
+		case hwmon_pwm_input:
+			if (cached) {
+				value = sensors.pwm[channel];
+			} else {
+				ret = regmap_read(data->regmap, uniwill_pwm_regs[channel], &value);
+				if (ret < 0)
+					return ret;
+			}
+
+			*val = fixp_linear_interpolate(0, 0, PWM_MAX, U8_MAX, value);
+			return 0;
+		case hwmon_pwm_enable:
+			ret = uniwill_read_reg(data, EC_ADDR_MANUAL_FAN_CTRL, &value);
+			if (ret < 0)
+				return ret;
+
+			if (data->fan_control)
+				*val = 3;
+			else if (data->thermal_control)
+				*val = 4;
+			else if (value & FAN_MODE_BOOST)
+				*val = 1;
+			else
+				*val = 2;
+
+			return 0;
+		default:
+			return -EOPNOTSUPP;
+		}
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_read);
+
+static int uniwill_read_string(struct device *dev, enum hwmon_sensor_types type, u32 attr,
+			       int channel, const char **str)
+{
+	switch (type) {
+	case hwmon_temp:
+		*str = uniwill_temp_labels[channel];
+		return 0;
+	case hwmon_fan:
+		*str = uniwill_fan_labels[channel];
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int uniwill_write(struct device *dev, enum hwmon_sensor_types type, u32 attr, int channel,
+			 long val)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	unsigned int value;
+	int ret, i;
+
+	switch (type) {
+	case hwmon_chip:
+		switch (attr) {
+		case hwmon_chip_update_interval:
+			value = clamp_val(val, UNIWILL_UPDATE_INTERVAL_MIN,
+					  UNIWILL_UPDATE_INTERVAL_MAX);
+
+			/* The backoff stays disabled and never drops below the new interval */
+			if (data->sample_interval_max == data->sample_interval)
+				WRITE_ONCE(data->sample_interval_max, value);
+			else
+				WRITE_ONCE(data->sample_interval_max,
+					   max(data->sample_interval_max, value));
+
+			WRITE_ONCE(data->sample_interval, value);
+			mod_delayed_work(system_wq, &data->sample_work, 0);
+
+			return 0;
+		case hwmon_chip_reset_history:
+			for (i = 0; i < UNIWILL_CHANNELS; i++)
+				uniwill_reset_history(data, i);
+
+			return 0;
+		default:
+			return -EOPNOTSUPP;
+		}
+	case hwmon_temp:
+		switch (attr) {
+		case hwmon_temp_reset_history:
+			uniwill_reset_history(data, channel);
+			return 0;
+		default:
+			return -EOPNOTSUPP;
+		}
+	case hwmon_pwm:
+		switch (attr) {
+		case hwmon_pwm_input:
+			value = fixp_linear_interpolate(0, 0, U8_MAX, PWM_MAX,
+							clamp_val(val, 0, U8_MAX));
+
+			mutex_lock(&data->curve_lock);
+			/* The duty cycle is owned by the kernel in modes 3 and 4 */
+			if (data->fan_control || data->thermal_control)
+				ret = -EBUSY;
+			else
+				ret = uniwill_write_pwm(data, channel, value);
+			mutex_unlock(&data->curve_lock);
+
+			return ret;
+		case hwmon_pwm_enable:
+			return uniwill_set_fan_mode(data, val);
+		default:
+			return -EOPNOTSUPP;
+		}
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static const struct hwmon_ops uniwill_ops = {
+	.is_visible = uniwill_is_visible,
+	.read = uniwill_read,
+	.read_string = uniwill_read_string,
+	.write = uniwill_write,
+};
 
 static const struct hwmon_channel_info * const uniwill_info[] = {
-	HWMON_CHANNEL_INFO(chip, HWMON_C_REGISTER_TZ),
+	HWMON_CHANNEL_INFO(chip, HWMON_C_REGISTER_TZ | HWMON_C_UPDATE_INTERVAL |
+			   HWMON_C_RESET_HISTORY),
 	HWMON_CHANNEL_INFO(temp,
-			   HWMON_T_INPUT | HWMON_T_LABEL,
-			   HWMON_T_INPUT | HWMON_T_LABEL),
+			   HWMON_T_INPUT | HWMON_T_LABEL | HWMON_T_LOWEST | HWMON_T_HIGHEST |
+			   HWMON_T_RESET_HISTORY,
+			   HWMON_T_INPUT | HWMON_T_LABEL | HWMON_T_LOWEST | HWMON_T_HIGHEST |
+			   HWMON_T_RESET_HISTORY),
 	HWMON_CHANNEL_INFO(fan,
 			   HWMON_F_INPUT | HWMON_F_LABEL,
 			   HWMON_F_INPUT | HWMON_F_LABEL),
@@ -555,89 +1912,1410 @@ static const struct hwmon_channel_info * const uniwill_info[] = {
 	NULL
 };
 
-static const struct hwmon_chip_info uniwill_chip_info = {
-	.ops = &uniwill_ops,
-	.info = uniwill_info,
-};
+static const struct hwmon_chip_info uniwill_chip_info = {
+	.ops = &uniwill_ops,
+	.info = uniwill_info,
+};
+
+static ssize_t uniwill_auto_point_temp_show(struct device *dev, struct device_attribute *attr,
+					    char *buf)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	int index = to_sensor_dev_attr(attr)->index;
+	unsigned int value;
+	int ret;
+
+	ret = regmap_read(data->regmap, EC_ADDR_FAN_DEFAULT + index, &value);
+	if (ret < 0)
+		return ret;
+
+	return sysfs_emit(buf, "%u\n", value * 1000);
+}
+
+static ssize_t uniwill_auto_point_temp_store(struct device *dev, struct device_attribute *attr,
+					     const char *buf, size_t count)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	int index = to_sensor_dev_attr(attr)->index;
+	u8 temps[FAN_CURVE_LENGTH];
+	long value;
+	int ret;
+
+	ret = kstrtol(buf, 10, &value);
+	if (ret < 0)
+		return ret;
+
+	value = clamp_val(DIV_ROUND_CLOSEST(value, 1000), 0, U8_MAX);
+
+	mutex_lock(&data->curve_lock);
+
+	/* Served from the regmap cache after the first access */
+	ret = regmap_bulk_read(data->regmap, EC_ADDR_FAN_DEFAULT, temps, sizeof(temps));
+	if (ret < 0)
+		goto out_unlock;
+
+	/* The EC expects the temperatures to be in ascending order */
+	if ((index > 0 && value < temps[index - 1]) ||
+	    (index < FAN_CURVE_LENGTH - 1 && value > temps[index + 1])) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	ret = uniwill_write_reg(data, EC_ADDR_FAN_DEFAULT + index, value);
+
+out_unlock:
+	mutex_unlock(&data->curve_lock);
+
+	if (ret < 0)
+		return ret;
+
+	return count;
+}
+
+/*
+ * The EC uses a fixed fan level for each curve point, so the duty cycles
+ * are only used by the in-kernel fan control loop (pwm1_enable = 3).
+ */
+static ssize_t uniwill_auto_point_pwm_show(struct device *dev, struct device_attribute *attr,
+					   char *buf)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	int index = to_sensor_dev_attr(attr)->index;
+
+	return sysfs_emit(buf, "%d\n", fixp_linear_interpolate(0, 0, PWM_MAX, U8_MAX,
+							      data->curve_pwm[index]));
+}
+
+static ssize_t uniwill_auto_point_pwm_store(struct device *dev, struct device_attribute *attr,
+					    const char *buf, size_t count)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	int index = to_sensor_dev_attr(attr)->index;
+	u8 value;
+	int ret;
+
+	ret = kstrtou8(buf, 10, &value);
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&data->curve_lock);
+	data->curve_pwm[index] = fixp_linear_interpolate(0, 0, U8_MAX, PWM_MAX, value);
+	mutex_unlock(&data->curve_lock);
+
+	return count;
+}
+
+static SENSOR_DEVICE_ATTR_RW(pwm1_auto_point1_temp, uniwill_auto_point_temp, 0);
+static SENSOR_DEVICE_ATTR_RW(pwm1_auto_point1_pwm, uniwill_auto_point_pwm, 0);
+static SENSOR_DEVICE_ATTR_RW(pwm1_auto_point2_temp, uniwill_auto_point_temp, 1);
+static SENSOR_DEVICE_ATTR_RW(pwm1_auto_point2_pwm, uniwill_auto_point_pwm, 1);
+static SENSOR_DEVICE_ATTR_RW(pwm1_auto_point3_temp, uniwill_auto_point_temp, 2);
+static SENSOR_DEVICE_ATTR_RW(pwm1_auto_point3_pwm, uniwill_auto_point_pwm, 2);
+static SENSOR_DEVICE_ATTR_RW(pwm1_auto_point4_temp, uniwill_auto_point_temp, 3);
+static SENSOR_DEVICE_ATTR_RW(pwm1_auto_point4_pwm, uniwill_auto_point_pwm, 3);
+static SENSOR_DEVICE_ATTR_RW(pwm1_auto_point5_temp, uniwill_auto_point_temp, 4);
+static SENSOR_DEVICE_ATTR_RW(pwm1_auto_point5_pwm, uniwill_auto_point_pwm, 4);
+
+/* The EC uses a single fan curve for both fans */
+static struct attribute *uniwill_curve_attrs[] = {
+	&sensor_dev_attr_pwm1_auto_point1_temp.dev_attr.attr,
+	&sensor_dev_attr_pwm1_auto_point1_pwm.dev_attr.attr,
+	&sensor_dev_attr_pwm1_auto_point2_temp.dev_attr.attr,
+	&sensor_dev_attr_pwm1_auto_point2_pwm.dev_attr.attr,
+	&sensor_dev_attr_pwm1_auto_point3_temp.dev_attr.attr,
+	&sensor_dev_attr_pwm1_auto_point3_pwm.dev_attr.attr,
+	&sensor_dev_attr_pwm1_auto_point4_temp.dev_attr.attr,
+	&sensor_dev_attr_pwm1_auto_point4_pwm.dev_attr.attr,
+	&sensor_dev_attr_pwm1_auto_point5_temp.dev_attr.attr,
+	&sensor_dev_attr_pwm1_auto_point5_pwm.dev_attr.attr,
+	NULL
+};
+
+static const struct attribute_group uniwill_curve_group = {
+	.attrs = uniwill_curve_attrs,
+};
+
+static const struct attribute_group *uniwill_hwmon_groups[] = {
+	&uniwill_curve_group,
+	NULL
+};
+
+static const char * const uniwill_zone_types[] = {
+	"uniwill-cpu",
+	"uniwill-gpu",
+};
+
+static const char * const uniwill_cooling_types[] = {
+	"uniwill-fan1",
+	"uniwill-fan2",
+};
+
+/*
+ * The firmware does not provide any trip points, so these are generic
+ * defaults which can be adjusted through the trip_point_*_temp attributes.
+ */
+static const struct thermal_trip uniwill_trips[] = {
+	{
+		.type = THERMAL_TRIP_ACTIVE,
+		.temperature = 55000,
+		.hysteresis = 2000,
+		.flags = THERMAL_TRIP_FLAG_RW_TEMP,
+	},
+	{
+		.type = THERMAL_TRIP_ACTIVE,
+		.temperature = 70000,
+		.hysteresis = 2000,
+		.flags = THERMAL_TRIP_FLAG_RW_TEMP,
+	},
+	{
+		.type = THERMAL_TRIP_ACTIVE,
+		.temperature = 85000,
+		.hysteresis = 2000,
+		.flags = THERMAL_TRIP_FLAG_RW_TEMP,
+	},
+};
+
+static int uniwill_tz_get_temp(struct thermal_zone_device *tzd, int *temp)
+{
+	struct uniwill_thermal *thermal = thermal_zone_device_priv(tzd);
+	struct uniwill_data *data = thermal->data;
+	struct uniwill_sensors sensors;
+	unsigned int value;
+	int ret;
+
+	if (uniwill_get_snapshot(data, &sensors)) {
+		value = sensors.temp[thermal->channel];
+	} else {
+		ret = regmap_read(data->regmap, uniwill_temp_regs[thermal->channel], &value);
+		if (ret < 0)
+			return ret;
+	}
+
+	*temp = value * 1000;
+
+	return 0;
+}
+
+static bool uniwill_is_cooling_device(struct uniwill_data *data,
+				      struct thermal_cooling_device *cdev)
+{
+	int i;
+
+	for (i = 0; i < UNIWILL_CHANNELS; i++) {
+		if (data->thermal[i].cdev == cdev)
+			return true;
+	}
+
+	return false;
+}
+
+/* Both fans share the heatpipes, so they cool both zones */
+static int uniwill_tz_bind(struct thermal_zone_device *tzd, struct thermal_cooling_device *cdev)
+{
+	struct uniwill_thermal *thermal = thermal_zone_device_priv(tzd);
+	int ret, i;
+
+	if (!uniwill_is_cooling_device(thermal->data, cdev))
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(uniwill_trips); i++) {
+		ret = thermal_zone_bind_cooling_device(tzd, i, cdev, THERMAL_NO_LIMIT,
+						       THERMAL_NO_LIMIT, THERMAL_WEIGHT_DEFAULT);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int uniwill_tz_unbind(struct thermal_zone_device *tzd,
+			     struct thermal_cooling_device *cdev)
+{
+	struct uniwill_thermal *thermal = thermal_zone_device_priv(tzd);
+	int ret, i;
+
+	if (!uniwill_is_cooling_device(thermal->data, cdev))
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(uniwill_trips); i++) {
+		ret = thermal_zone_unbind_cooling_device(tzd, i, cdev);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static const struct thermal_zone_device_ops uniwill_tz_ops = {
+	.get_temp = uniwill_tz_get_temp,
+	.bind = uniwill_tz_bind,
+	.unbind = uniwill_tz_unbind,
+};
+
+static int uniwill_cooling_get_max_state(struct thermal_cooling_device *cdev,
+					 unsigned long *state)
+{
+	*state = UNIWILL_COOLING_STATES;
+
+	return 0;
+}
+
+static int uniwill_cooling_get_cur_state(struct thermal_cooling_device *cdev,
+					 unsigned long *state)
+{
+	struct uniwill_thermal *thermal = cdev->devdata;
+	struct uniwill_data *data = thermal->data;
+	struct uniwill_sensors sensors;
+	unsigned int value;
+	int ret;
+
+	if (uniwill_get_snapshot(data, &sensors)) {
+		value = sensors.pwm[thermal->channel];
+	} else {
+		ret = regmap_read(data->regmap, uniwill_pwm_regs[thermal->channel], &value);
+		if (ret < 0)
+			return ret;
+	}
+
+	*state = DIV_ROUND_CLOSEST(min(value, PWM_MAX) * UNIWILL_COOLING_STATES, PWM_MAX);
+
+	return 0;
+}
+
+static int uniwill_cooling_set_cur_state(struct thermal_cooling_device *cdev,
+					 unsigned long state)
+{
+	struct uniwill_thermal *thermal = cdev->devdata;
+	struct uniwill_data *data = thermal->data;
+	unsigned int value;
+	int ret;
+
+	if (state > UNIWILL_COOLING_STATES)
+		return -EINVAL;
+
+	/* Never let a governor stop the fans */
+	value = max_t(unsigned int, state * PWM_MAX / UNIWILL_COOLING_STATES,
+		      UNIWILL_COOLING_PWM_MIN);
+
+	mutex_lock(&data->curve_lock);
+	/* The fans are only handed to the thermal framework with pwm_enable = 4 */
+	if (data->thermal_control)
+		ret = uniwill_write_pwm(data, thermal->channel, value);
+	else
+		ret = -EBUSY;
+	mutex_unlock(&data->curve_lock);
+
+	return ret;
+}
+
+static const struct thermal_cooling_device_ops uniwill_cooling_ops = {
+	.get_max_state = uniwill_cooling_get_max_state,
+	.get_cur_state = uniwill_cooling_get_cur_state,
+	.set_cur_state = uniwill_cooling_set_cur_state,
+};
+
+static void uniwill_thermal_zone_unregister(void *context)
+{
+	struct thermal_zone_device *tzd = context;
+
+	thermal_zone_device_unregister(tzd);
+}
+
+static int uniwill_thermal_init(struct uniwill_data *data)
+{
+	struct device *dev = &data->wdev->dev;
+	struct thermal_cooling_device *cdev;
+	struct thermal_zone_device *tzd;
+	int ret, i;
+
+	for (i = 0; i < UNIWILL_CHANNELS; i++) {
+		data->thermal[i].data = data;
+		data->thermal[i].channel = i;
+
+		cdev = devm_thermal_of_cooling_device_register(dev, NULL, uniwill_cooling_types[i],
+							       &data->thermal[i],
+							       &uniwill_cooling_ops);
+		if (IS_ERR(cdev))
+			return PTR_ERR(cdev);
+
+		data->thermal[i].cdev = cdev;
+	}
+
+	/* Updates are pushed by the sampler or the control work */
+	for (i = 0; i < UNIWILL_CHANNELS; i++) {
+		tzd = thermal_zone_device_register_with_trips(uniwill_zone_types[i], uniwill_trips,
+							      ARRAY_SIZE(uniwill_trips),
+							      &data->thermal[i], &uniwill_tz_ops,
+							      NULL, 0, 0);
+		if (IS_ERR(tzd))
+			return PTR_ERR(tzd);
+
+		ret = devm_add_action_or_reset(dev, uniwill_thermal_zone_unregister, tzd);
+		if (ret < 0)
+			return ret;
+
+		data->thermal[i].tzd = tzd;
+
+		ret = thermal_zone_device_enable(tzd);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void uniwill_disable_manual_control(void *context)
+{
+	struct uniwill_data *data = context;
+
+	regmap_update_bits(data->regmap, EC_ADDR_AP_OEM, ENABLE_MANUAL_CTRL, 0);
+}
+
+static void uniwill_cancel_work(void *context)
+{
+	struct uniwill_data *data = context;
+
+	cancel_delayed_work_sync(&data->sample_work);
+	cancel_delayed_work_sync(&data->control_work);
+}
+
+/* The works are only started once the interfaces using them are registered */
+static int uniwill_fan_init(struct uniwill_data *data)
+{
+	int ret, i;
+
+	if (sample_interval)
+		data->sample_interval = clamp_val(sample_interval, UNIWILL_UPDATE_INTERVAL_MIN,
+						  UNIWILL_UPDATE_INTERVAL_MAX);
+
+	data->sample_interval_max = max(data->sample_interval, sample_interval_max);
+	data->sample_delay = data->sample_interval;
+
+	ret = devm_mutex_init(&data->wdev->dev, &data->curve_lock);
+	if (ret < 0)
+		return ret;
+
+	/*
+	 * The EC does not expose the duty cycles of its fan levels, so the
+	 * curve defaults to evenly spaced duty cycles until configured.
+	 */
+	for (i = 0; i < FAN_CURVE_LENGTH; i++)
+		data->curve_pwm[i] = (i + 1) * PWM_MAX / FAN_CURVE_LENGTH;
+
+	INIT_DELAYED_WORK(&data->control_work, uniwill_control_work);
+	INIT_DELAYED_WORK(&data->sample_work, uniwill_sample_work);
+
+	return 0;
+}
+
+static int uniwill_hwmon_init(struct uniwill_data *data)
+{
+	struct device *hdev;
+	int ret;
+
+	/* The cooling devices use the fan control state */
+	ret = uniwill_thermal_init(data);
+	if (ret < 0)
+		return ret;
+
+	if (data->sample_interval) {
+		/* The telemetry records are produced by the sampler */
+		ret = uniwill_telemetry_init(data);
+		if (ret < 0)
+			return ret;
+	}
+
+	/* Both works update the thermal zones, so they are cancelled first */
+	ret = devm_add_action_or_reset(&data->wdev->dev, uniwill_cancel_work, data);
+	if (ret < 0)
+		return ret;
+
+	if (data->sample_interval)
+		schedule_delayed_work(&data->sample_work, 0);
+
+	hdev = devm_hwmon_device_register_with_info(&data->wdev->dev, "uniwill", data,
+						    &uniwill_chip_info, uniwill_hwmon_groups);
+
+	return PTR_ERR_OR_ZERO(hdev);
+}
+
+/*
+ * The EC reports no upper bound for the CPU power limits, so they are only
+ * bounded by each other (PL1 <= PL2 <= PL4) and the register width. The same
+ * goes for the cTGP offset, EC_ADDR_MAX_TGP holds the absolute maximum TGP
+ * of the GPU and not the range of the offset.
+ */
+static const struct uniwill_limit uniwill_limits[UNIWILL_LIMIT_COUNT] = {
+	[UNIWILL_LIMIT_PL1] = {
+		.display_name = "CPU sustained power limit (PL1) in Watt",
+		.reg = EC_ADDR_PL1_SETTING,
+		.min = 1,
+		.max = U8_MAX,
+	},
+	[UNIWILL_LIMIT_PL2] = {
+		.display_name = "CPU burst power limit (PL2) in Watt",
+		.reg = EC_ADDR_PL2_SETTING,
+		.min = 1,
+		.max = U8_MAX,
+	},
+	[UNIWILL_LIMIT_PL4] = {
+		.display_name = "CPU peak power limit (PL4) in Watt",
+		.reg = EC_ADDR_PL4_SETTING,
+		.min = 1,
+		.max = U8_MAX,
+	},
+	[UNIWILL_LIMIT_CTGP_OFFSET] = {
+		.display_name = "GPU configurable TGP offset in Watt",
+		.reg = EC_ADDR_CTGP_OFFSET,
+		.max = U8_MAX,
+		.ctrl_mask = CTGP_DB_GENERAL_ENABLE | CTGP_DB_CTGP_ENABLE,
+	},
+	[UNIWILL_LIMIT_TPP_OFFSET] = {
+		.display_name = "Total processing power offset in Watt",
+		.reg = EC_ADDR_TPP_OFFSET,
+		.max = UNIWILL_TPP_OFFSET_MAX,
+		.ctrl_mask = CTGP_DB_GENERAL_ENABLE,
+	},
+};
+
+static bool uniwill_limit_supported(const struct uniwill_data *data,
+				    enum uniwill_limit_index index)
+{
+	switch (index) {
+	case UNIWILL_LIMIT_CTGP_OFFSET:
+		return test_bit(UNIWILL_FEATURE_CTGP, data->features);
+	case UNIWILL_LIMIT_TPP_OFFSET:
+		return test_bit(UNIWILL_FEATURE_TPP, data->features);
+	default:
+		return true;
+	}
+}
+
+static bool uniwill_limit_valid(struct uniwill_data *data, enum uniwill_limit_index index,
+				unsigned int value)
+{
+	return value >= uniwill_limits[index].min && value <= data->limits[index].max_value;
+}
+
+VISIBLE_IF_KUNIT bool uniwill_limits_ordered(const unsigned int *limits)
+{
+	return limits[UNIWILL_LIMIT_PL1] <= limits[UNIWILL_LIMIT_PL2] &&
+	       limits[UNIWILL_LIMIT_PL2] <= limits[UNIWILL_LIMIT_PL4];
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_limits_ordered);
+
+static const enum uniwill_limit_index uniwill_cpu_limits[] = {
+	UNIWILL_LIMIT_PL1,
+	UNIWILL_LIMIT_PL2,
+	UNIWILL_LIMIT_PL4,
+};
+
+static int uniwill_set_limit(struct uniwill_data *data, enum uniwill_limit_index index,
+			     unsigned int value)
+{
+	const struct uniwill_limit *limit = &uniwill_limits[index];
+	struct uniwill_pending_write writes[] = {
+		{ .reg = limit->reg, .mask = GENMASK(7, 0), .value = value },
+		{
+			.reg = EC_ADDR_CTGP_DB_CTRL,
+			.mask = limit->ctrl_mask,
+			.value = limit->ctrl_mask,
+		},
+	};
+	unsigned int limits[UNIWILL_LIMIT_COUNT] = { };
+	unsigned int old[ARRAY_SIZE(writes)];
+	int ret, i;
+
+	if (!uniwill_limit_valid(data, index, value))
+		return -EINVAL;
+
+	mutex_lock(&data->limit_lock);
+
+	for (i = 0; i < ARRAY_SIZE(uniwill_cpu_limits); i++) {
+		ret = uniwill_read_reg(data, uniwill_limits[uniwill_cpu_limits[i]].reg,
+				       &limits[uniwill_cpu_limits[i]]);
+		if (ret < 0)
+			goto out_unlock;
+	}
+
+	limits[index] = value;
+	if (!uniwill_limits_ordered(limits)) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	/* The enable bits must not reach the EC before the new value */
+	ret = uniwill_write_transaction(data, writes, limit->ctrl_mask ? 2 : 1, old);
+
+out_unlock:
+	mutex_unlock(&data->limit_lock);
+
+	return ret;
+}
+
+static ssize_t uniwill_limit_current_value_show(struct device *dev, struct device_attribute *attr,
+						char *buf)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	int index = to_uniwill_limit_attr(attr)->index;
+	unsigned int value;
+	int ret;
+
+	ret = uniwill_read_reg(data, uniwill_limits[index].reg, &value);
+	if (ret < 0)
+		return ret;
+
+	return sysfs_emit(buf, "%u\n", value);
+}
+
+static ssize_t uniwill_limit_current_value_store(struct device *dev, struct device_attribute *attr,
+						 const char *buf, size_t count)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	int index = to_uniwill_limit_attr(attr)->index;
+	unsigned int value;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &value);
+	if (ret < 0)
+		return ret;
+
+	ret = uniwill_set_limit(data, index, value);
+	if (ret < 0)
+		return ret;
+
+	return count;
+}
+
+static ssize_t uniwill_limit_default_value_show(struct device *dev, struct device_attribute *attr,
+						char *buf)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	int index = to_uniwill_limit_attr(attr)->index;
+
+	return sysfs_emit(buf, "%u\n", data->limits[index].default_value);
+}
+
+static ssize_t uniwill_limit_min_value_show(struct device *dev, struct device_attribute *attr,
+					    char *buf)
+{
+	int index = to_uniwill_limit_attr(attr)->index;
+
+	return sysfs_emit(buf, "%u\n", uniwill_limits[index].min);
+}
+
+static ssize_t uniwill_limit_max_value_show(struct device *dev, struct device_attribute *attr,
+					    char *buf)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	int index = to_uniwill_limit_attr(attr)->index;
+
+	return sysfs_emit(buf, "%u\n", data->limits[index].max_value);
+}
+
+static ssize_t uniwill_limit_scalar_increment_show(struct device *dev,
+						   struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "1\n");
+}
+
+static ssize_t uniwill_limit_display_name_show(struct device *dev, struct device_attribute *attr,
+					       char *buf)
+{
+	int index = to_uniwill_limit_attr(attr)->index;
+
+	return sysfs_emit(buf, "%s\n", uniwill_limits[index].display_name);
+}
+
+static ssize_t uniwill_limit_type_show(struct device *dev, struct device_attribute *attr,
+				       char *buf)
+{
+	return sysfs_emit(buf, "integer\n");
+}
+
+static umode_t uniwill_limit_is_visible(struct kobject *kobj, struct attribute *attr, int n)
+{
+	struct device_attribute *dev_attr = container_of(attr, struct device_attribute, attr);
+	struct uniwill_data *data = dev_get_drvdata(kobj_to_dev(kobj));
+
+	if (!uniwill_limit_supported(data, to_uniwill_limit_attr(dev_attr)->index))
+		return 0;
+
+	return attr->mode;
+}
+
+/*
+ * Mimics the layout of the integer attributes from the firmware-attributes class.
+ * The groups live below the WMI device and not inside /sys/class/firmware-attributes,
+ * since the class helpers are private to drivers/platform/x86.
+ */
+#define UNIWILL_LIMIT_ATTR(_name, _mode, _show, _store, _index)				\
+	{ .dev_attr = __ATTR(_name, _mode, _show, _store), .index = _index }
+
+#define UNIWILL_LIMIT_GROUP(_name, _index)						\
+	static struct uniwill_limit_attribute uniwill_##_name##_attrs[] = {		\
+		UNIWILL_LIMIT_ATTR(current_value, 0644,					\
+				   uniwill_limit_current_value_show,			\
+				   uniwill_limit_current_value_store, _index),		\
+		UNIWILL_LIMIT_ATTR(default_value, 0444,					\
+				   uniwill_limit_default_value_show, NULL, _index),	\
+		UNIWILL_LIMIT_ATTR(min_value, 0444, uniwill_limit_min_value_show, NULL,	\
+				   _index),						\
+		UNIWILL_LIMIT_ATTR(max_value, 0444, uniwill_limit_max_value_show, NULL,	\
+				   _index),						\
+		UNIWILL_LIMIT_ATTR(scalar_increment, 0444,				\
+				   uniwill_limit_scalar_increment_show, NULL, _index),	\
+		UNIWILL_LIMIT_ATTR(display_name, 0444, uniwill_limit_display_name_show,	\
+				   NULL, _index),					\
+		UNIWILL_LIMIT_ATTR(type, 0444, uniwill_limit_type_show, NULL, _index),	\
+	};										\
+											\
+	static struct attribute *uniwill_##_name##_group_attrs[] = {			\
+		&uniwill_##_name##_attrs[0].dev_attr.attr,				\
+		&uniwill_##_name##_attrs[1].dev_attr.attr,				\
+		&uniwill_##_name##_attrs[2].dev_attr.attr,				\
+		&uniwill_##_name##_attrs[3].dev_attr.attr,				\
+		&uniwill_##_name##_attrs[4].dev_attr.attr,				\
+		&uniwill_##_name##_attrs[5].dev_attr.attr,				\
+		&uniwill_##_name##_attrs[6].dev_attr.attr,				\
+		NULL									\
+	};										\
+											\
+	static const struct attribute_group uniwill_##_name##_group = {			\
+		.name = #_name,								\
+		.attrs = uniwill_##_name##_group_attrs,					\
+		.is_visible = uniwill_limit_is_visible,					\
+	}
+
+UNIWILL_LIMIT_GROUP(pl1, UNIWILL_LIMIT_PL1);
+UNIWILL_LIMIT_GROUP(pl2, UNIWILL_LIMIT_PL2);
+UNIWILL_LIMIT_GROUP(pl4, UNIWILL_LIMIT_PL4);
+UNIWILL_LIMIT_GROUP(ctgp_offset, UNIWILL_LIMIT_CTGP_OFFSET);
+UNIWILL_LIMIT_GROUP(tpp_offset, UNIWILL_LIMIT_TPP_OFFSET);
+
+static const char * const uniwill_dynamic_boost_values[] = {
+	"disabled",
+	"enabled",
+};
+
+static ssize_t uniwill_dynamic_boost_current_value_show(struct device *dev,
+							struct device_attribute *attr, char *buf)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	unsigned int value;
+	int ret;
+
+	ret = uniwill_read_reg(data, EC_ADDR_CTGP_DB_CTRL, &value);
+	if (ret < 0)
+		return ret;
+
+	return sysfs_emit(buf, "%s\n", uniwill_dynamic_boost_values[!!(value & CTGP_DB_DB_ENABLE)]);
+}
+
+static ssize_t uniwill_dynamic_boost_current_value_store(struct device *dev,
+							 struct device_attribute *attr,
+							 const char *buf, size_t count)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	unsigned int mask = CTGP_DB_GENERAL_ENABLE | CTGP_DB_DB_ENABLE;
+	int ret;
+
+	ret = sysfs_match_string(uniwill_dynamic_boost_values, buf);
+	if (ret < 0)
+		return ret;
+
+	/* The general enable bit is shared with the offsets, so leave it set */
+	if (ret)
+		ret = uniwill_update_bits(data, EC_ADDR_CTGP_DB_CTRL, mask, mask);
+	else
+		ret = uniwill_update_bits(data, EC_ADDR_CTGP_DB_CTRL, CTGP_DB_DB_ENABLE, 0);
+
+	if (ret < 0)
+		return ret;
+
+	return count;
+}
+
+static ssize_t uniwill_dynamic_boost_default_value_show(struct device *dev,
+							struct device_attribute *attr, char *buf)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%s\n", uniwill_dynamic_boost_values[data->dynamic_boost_default]);
+}
+
+static ssize_t uniwill_dynamic_boost_possible_values_show(struct device *dev,
+							  struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%s;%s\n", uniwill_dynamic_boost_values[0],
+			  uniwill_dynamic_boost_values[1]);
+}
+
+static ssize_t uniwill_dynamic_boost_display_name_show(struct device *dev,
+						       struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "GPU Dynamic Boost\n");
+}
+
+static ssize_t uniwill_dynamic_boost_type_show(struct device *dev, struct device_attribute *attr,
+					       char *buf)
+{
+	return sysfs_emit(buf, "enumeration\n");
+}
+
+static struct device_attribute uniwill_dynamic_boost_attrs[] = {
+	__ATTR(current_value, 0644, uniwill_dynamic_boost_current_value_show,
+	       uniwill_dynamic_boost_current_value_store),
+	__ATTR(default_value, 0444, uniwill_dynamic_boost_default_value_show, NULL),
+	__ATTR(possible_values, 0444, uniwill_dynamic_boost_possible_values_show, NULL),
+	__ATTR(display_name, 0444, uniwill_dynamic_boost_display_name_show, NULL),
+	__ATTR(type, 0444, uniwill_dynamic_boost_type_show, NULL),
+};
+
+static struct attribute *uniwill_dynamic_boost_group_attrs[] = {
+	&uniwill_dynamic_boost_attrs[0].attr,
+	&uniwill_dynamic_boost_attrs[1].attr,
+	&uniwill_dynamic_boost_attrs[2].attr,
+	&uniwill_dynamic_boost_attrs[3].attr,
+	&uniwill_dynamic_boost_attrs[4].attr,
+	NULL
+};
+
+static umode_t uniwill_dynamic_boost_is_visible(struct kobject *kobj, struct attribute *attr,
+						int n)
+{
+	struct uniwill_data *data = dev_get_drvdata(kobj_to_dev(kobj));
+
+	if (!test_bit(UNIWILL_FEATURE_DYNAMIC_BOOST, data->features))
+		return 0;
+
+	return attr->mode;
+}
+
+static const struct attribute_group uniwill_dynamic_boost_group = {
+	.name = "dynamic_boost",
+	.attrs = uniwill_dynamic_boost_group_attrs,
+	.is_visible = uniwill_dynamic_boost_is_visible,
+};
+
+static int uniwill_limit_init(struct uniwill_data *data, enum uniwill_limit_index index)
+{
+	const struct uniwill_limit *limit = &uniwill_limits[index];
+	unsigned int value;
+	int ret;
+
+	ret = regmap_read(data->regmap, limit->reg, &value);
+	if (ret < 0)
+		return ret;
+
+	data->limits[index].default_value = value;
+	data->limits[index].max_value = max(limit->max, value);
+
+	dev_dbg(&data->wdev->dev, "%s: default %u, max %u\n", limit->display_name,
+		data->limits[index].default_value, data->limits[index].max_value);
+
+	return 0;
+}
+
+static int uniwill_limits_init(struct uniwill_data *data)
+{
+	unsigned int value;
+	int ret, i;
+
+	ret = devm_mutex_init(&data->wdev->dev, &data->limit_lock);
+	if (ret < 0)
+		return ret;
+
+	/*
+	 * The values found during probe are treated as the factory settings.
+	 * The EC has no known register holding the real factory values, so
+	 * after reloading the driver the values of the last applied profile
+	 * become the defaults.
+	 */
+	for (i = 0; i < ARRAY_SIZE(uniwill_cpu_limits); i++) {
+		ret = uniwill_limit_init(data, uniwill_cpu_limits[i]);
+		if (ret < 0)
+			return ret;
+	}
+
+	/* The GPU power registers are undocumented, so treat them as optional */
+	ret = regmap_read(data->regmap, EC_ADDR_CTGP_DB_CTRL, &value);
+	if (ret < 0) {
+		dev_warn(&data->wdev->dev, "Failed to read GPU power control: %d\n", ret);
+		return 0;
+	}
+
+	data->dynamic_boost_default = value & CTGP_DB_DB_ENABLE;
+	__set_bit(UNIWILL_FEATURE_DYNAMIC_BOOST, data->features);
+
+	if (!uniwill_limit_init(data, UNIWILL_LIMIT_CTGP_OFFSET))
+		__set_bit(UNIWILL_FEATURE_CTGP, data->features);
+
+	if (!uniwill_limit_init(data, UNIWILL_LIMIT_TPP_OFFSET))
+		__set_bit(UNIWILL_FEATURE_TPP, data->features);
+
+	return 0;
+}
+
+struct uniwill_profile {
+	const char *name;
+	enum platform_profile_option option;
+	unsigned int fan_mode;
+};
+
+/* The quiet profiles limit the fan speed through FAN_QUIET instead */
+static const struct uniwill_profile uniwill_profiles[UNIWILL_PROFILE_COUNT] = {
+	[UNIWILL_PROFILE_LOW_POWER] = {
+		.name = "low-power",
+		.option = PLATFORM_PROFILE_LOW_POWER,
+		.fan_mode = FAN_MODE_USER | FAN_MODE_HIGH,
+	},
+	[UNIWILL_PROFILE_QUIET] = {
+		.name = "quiet",
+		.option = PLATFORM_PROFILE_QUIET,
+		.fan_mode = FAN_MODE_USER | FAN_MODE_HIGH,
+	},
+	[UNIWILL_PROFILE_BALANCED] = {
+		.name = "balanced",
+		.option = PLATFORM_PROFILE_BALANCED,
+		.fan_mode = FAN_MODE_USER | FAN_MODE_HIGH,
+	},
+	[UNIWILL_PROFILE_BALANCED_PERFORMANCE] = {
+		.name = "balanced-performance",
+		.option = PLATFORM_PROFILE_BALANCED_PERFORMANCE,
+		.fan_mode = 0x00,
+	},
+	[UNIWILL_PROFILE_PERFORMANCE] = {
+		.name = "performance",
+		.option = PLATFORM_PROFILE_PERFORMANCE,
+		.fan_mode = FAN_MODE_TURBO,
+	},
+};
+
+static bool uniwill_profile_supported(const struct uniwill_data *data,
+				      enum uniwill_profile_index index)
+{
+	switch (index) {
+	case UNIWILL_PROFILE_LOW_POWER:
+	case UNIWILL_PROFILE_QUIET:
+		return test_bit(UNIWILL_FEATURE_SILENT_MODE, data->features);
+	default:
+		return true;
+	}
+}
+
+VISIBLE_IF_KUNIT int uniwill_profile_get(struct uniwill_data *data,
+					 enum platform_profile_option *profile)
+{
+	unsigned int mask = FAN_MODE_USER | FAN_MODE_HIGH | FAN_MODE_TURBO;
+	unsigned int value;
+	int ret;
+
+	ret = uniwill_read_reg(data, EC_ADDR_MANUAL_FAN_CTRL, &value);
+	if (ret < 0)
+		return ret;
+
+	switch (value & mask) {
+	case (FAN_MODE_USER | FAN_MODE_HIGH):
+		*profile = PLATFORM_PROFILE_BALANCED;
+		break;
+	case 0x00:
+		*profile = PLATFORM_PROFILE_BALANCED_PERFORMANCE;
+		break;
+	case FAN_MODE_TURBO:
+		*profile = PLATFORM_PROFILE_PERFORMANCE;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* The EC cannot tell apart profiles which share a fan mode */
+	mutex_lock(&data->profile_lock);
+	if (data->profile_valid && uniwill_profiles[data->profile].fan_mode == (value & mask))
+		*profile = uniwill_profiles[data->profile].option;
+	mutex_unlock(&data->profile_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_profile_get);
+
+static int uniwill_platform_profile_get(struct platform_profile_handler *pprof,
+					enum platform_profile_option *profile)
+{
+	struct uniwill_data *data = container_of(pprof, struct uniwill_data, profile_handler);
+
+	return uniwill_profile_get(data, profile);
+}
+
+/* The CPU limits, the cTGP offset with its control bits, EC_ADDR_OEM_3 and the fan mode */
+#define UNIWILL_BUNDLE_WRITES	(ARRAY_SIZE(uniwill_cpu_limits) + 4)
+
+static void uniwill_bundle_add_limit(struct uniwill_pending_write *writes, unsigned int *count,
+				     enum uniwill_limit_index index, unsigned int value)
+{
+	writes[(*count)++] = (struct uniwill_pending_write) {
+		.reg = uniwill_limits[index].reg,
+		.mask = GENMASK(7, 0),
+		.value = value,
+	};
+}
+
+/*
+ * The cTGP offset is only written when the EC holds a different value, and
+ * the cTGP control is only enabled for offsets other than the factory value.
+ */
+static int uniwill_bundle_add_ctgp(struct uniwill_data *data, struct uniwill_pending_write *writes,
+				   unsigned int *count, unsigned int offset)
+{
+	const struct uniwill_limit *limit = &uniwill_limits[UNIWILL_LIMIT_CTGP_OFFSET];
+	unsigned int value;
+	int ret;
+
+	ret = uniwill_read_reg(data, limit->reg, &value);
+	if (ret < 0)
+		return ret;
+
+	if (offset == value)
+		return 0;
+
+	uniwill_bundle_add_limit(writes, count, UNIWILL_LIMIT_CTGP_OFFSET, offset);
+
+	if (offset != data->limits[UNIWILL_LIMIT_CTGP_OFFSET].default_value) {
+		writes[(*count)++] = (struct uniwill_pending_write) {
+			.reg = EC_ADDR_CTGP_DB_CTRL,
+			.mask = limit->ctrl_mask,
+			.value = limit->ctrl_mask,
+		};
+	}
+
+	return 0;
+}
+
+static int uniwill_apply_profile(struct uniwill_data *data, enum uniwill_profile_index index)
+{
+	const struct uniwill_bundle *bundle = &data->bundles[index];
+	struct uniwill_pending_write writes[UNIWILL_BUNDLE_WRITES];
+	unsigned int current_limits[UNIWILL_LIMIT_COUNT];
+	unsigned int old[UNIWILL_BUNDLE_WRITES];
+	enum uniwill_limit_index limit;
+	unsigned int count = 0;
+	unsigned int value;
+	int ret, i;
+
+	lockdep_assert_held(&data->profile_lock);
+
+	mutex_lock(&data->limit_lock);
+
+	for (i = 0; i < ARRAY_SIZE(uniwill_cpu_limits); i++) {
+		limit = uniwill_cpu_limits[i];
+
+		ret = uniwill_read_reg(data, uniwill_limits[limit].reg, &current_limits[limit]);
+		if (ret < 0)
+			goto out_unlock;
+	}
+
+	/*
+	 * Lower the limits starting with PL1 and raise them starting with PL4,
+	 * so that PL1 <= PL2 <= PL4 holds after each write.
+	 */
+	for (i = 0; i < ARRAY_SIZE(uniwill_cpu_limits); i++) {
+		limit = uniwill_cpu_limits[i];
+
+		if (bundle->limits[limit] < current_limits[limit])
+			uniwill_bundle_add_limit(writes, &count, limit, bundle->limits[limit]);
+	}
+
+	for (i = ARRAY_SIZE(uniwill_cpu_limits) - 1; i >= 0; i--) {
+		limit = uniwill_cpu_limits[i];
+
+		if (bundle->limits[limit] > current_limits[limit])
+			uniwill_bundle_add_limit(writes, &count, limit, bundle->limits[limit]);
+	}
+
+	if (test_bit(UNIWILL_FEATURE_CTGP, data->features)) {
+		ret = uniwill_bundle_add_ctgp(data, writes, &count,
+					      bundle->limits[UNIWILL_LIMIT_CTGP_OFFSET]);
+		if (ret < 0)
+			goto out_unlock;
+	}
+
+	if (test_bit(UNIWILL_FEATURE_OEM_3, data->features)) {
+		ret = uniwill_read_reg(data, EC_ADDR_OEM_3, &value);
+		if (ret < 0)
+			goto out_unlock;
+
+		if ((value & (OVERBOOST | FAN_QUIET)) != bundle->oem_3) {
+			writes[count++] = (struct uniwill_pending_write) {
+				.reg = EC_ADDR_OEM_3,
+				.mask = OVERBOOST | FAN_QUIET,
+				.value = bundle->oem_3,
+			};
+		}
+	}
+
+	/* The fan mode comes last so that the EC switches with the new limits in place */
+	writes[count++] = (struct uniwill_pending_write) {
+		.reg = EC_ADDR_MANUAL_FAN_CTRL,
+		.mask = FAN_MODE_USER | FAN_MODE_HIGH | FAN_MODE_TURBO,
+		.value = uniwill_profiles[index].fan_mode,
+	};
+
+	ret = uniwill_write_transaction(data, writes, count, old);
+
+out_unlock:
+	mutex_unlock(&data->limit_lock);
 
-static void uniwill_disable_manual_control(void *context)
+	return ret;
+}
+
+static int uniwill_select_profile(struct uniwill_data *data, enum uniwill_profile_index index)
 {
-	struct uniwill_data *data = context;
+	int ret;
 
-	regmap_update_bits(data->regmap, EC_ADDR_AP_OEM, ENABLE_MANUAL_CTRL, 0);
+	if (!uniwill_profile_supported(data, index))
+		return -EOPNOTSUPP;
+
+	mutex_lock(&data->profile_lock);
+	ret = uniwill_apply_profile(data, index);
+	if (!ret) {
+		data->profile = index;
+		data->profile_valid = true;
+	}
+	mutex_unlock(&data->profile_lock);
+
+	return ret;
 }
 
-static int uniwill_hwmon_init(struct uniwill_data *data)
+VISIBLE_IF_KUNIT int uniwill_profile_set(struct uniwill_data *data,
+					 enum platform_profile_option profile)
 {
-	struct device *hdev;
+	int i;
 
-	hdev = devm_hwmon_device_register_with_info(&data->wdev->dev, "uniwill", data,
-						    &uniwill_chip_info, NULL);
+	for (i = 0; i < UNIWILL_PROFILE_COUNT; i++) {
+		if (uniwill_profiles[i].option == profile)
+			return uniwill_select_profile(data, i);
+	}
 
-	return PTR_ERR_OR_ZERO(hdev);
+	return -EINVAL;
 }
+EXPORT_SYMBOL_IF_KUNIT(uniwill_profile_set);
 
-static int uniwill_platform_profile_get(struct platform_profile_handler *pprof,
-					enum platform_profile_option *profile)
+static int uniwill_platform_profile_set(struct platform_profile_handler *pprof,
+					enum platform_profile_option profile)
 {
 	struct uniwill_data *data = container_of(pprof, struct uniwill_data, profile_handler);
-	unsigned int mask = FAN_MODE_USER | FAN_MODE_HIGH | FAN_MODE_TURBO;
+
+	return uniwill_profile_set(data, profile);
+}
+
+static ssize_t uniwill_bundle_limit_show(struct device *dev, struct device_attribute *attr,
+					 char *buf)
+{
+	struct uniwill_bundle_attribute *battr = to_uniwill_bundle_attr(attr);
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	unsigned int value;
+
+	mutex_lock(&data->profile_lock);
+	value = data->bundles[battr->profile].limits[battr->index];
+	mutex_unlock(&data->profile_lock);
+
+	return sysfs_emit(buf, "%u\n", value);
+}
+
+static ssize_t uniwill_bundle_limit_store(struct device *dev, struct device_attribute *attr,
+					  const char *buf, size_t count)
+{
+	struct uniwill_bundle_attribute *battr = to_uniwill_bundle_attr(attr);
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	unsigned int limits[UNIWILL_LIMIT_COUNT];
 	unsigned int value;
 	int ret;
 
-	ret = regmap_read(data->regmap, EC_ADDR_MANUAL_FAN_CTRL, &value);
+	ret = kstrtouint(buf, 0, &value);
 	if (ret < 0)
 		return ret;
 
-	switch (value & mask) {
-	case (FAN_MODE_USER | FAN_MODE_HIGH):
-		*profile = PLATFORM_PROFILE_BALANCED;
-		return 0;
-	case 0x00:
-		*profile = PLATFORM_PROFILE_BALANCED_PERFORMANCE;
+	if (!uniwill_limit_valid(data, battr->index, value))
+		return -EINVAL;
+
+	/* Takes effect the next time the profile is selected */
+	mutex_lock(&data->profile_lock);
+
+	memcpy(limits, data->bundles[battr->profile].limits, sizeof(limits));
+	limits[battr->index] = value;
+	if (uniwill_limits_ordered(limits))
+		data->bundles[battr->profile].limits[battr->index] = value;
+	else
+		ret = -EINVAL;
+
+	mutex_unlock(&data->profile_lock);
+
+	if (ret < 0)
+		return ret;
+
+	return count;
+}
+
+/* The index holds the EC_ADDR_OEM_3 bit controlled by the attribute */
+static ssize_t uniwill_bundle_flag_show(struct device *dev, struct device_attribute *attr,
+					char *buf)
+{
+	struct uniwill_bundle_attribute *battr = to_uniwill_bundle_attr(attr);
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	bool value;
+
+	mutex_lock(&data->profile_lock);
+	value = data->bundles[battr->profile].oem_3 & battr->index;
+	mutex_unlock(&data->profile_lock);
+
+	return sysfs_emit(buf, "%d\n", value);
+}
+
+static ssize_t uniwill_bundle_flag_store(struct device *dev, struct device_attribute *attr,
+					 const char *buf, size_t count)
+{
+	struct uniwill_bundle_attribute *battr = to_uniwill_bundle_attr(attr);
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	bool value;
+	int ret;
+
+	ret = kstrtobool(buf, &value);
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&data->profile_lock);
+	if (value)
+		data->bundles[battr->profile].oem_3 |= battr->index;
+	else
+		data->bundles[battr->profile].oem_3 &= ~battr->index;
+	mutex_unlock(&data->profile_lock);
+
+	return count;
+}
+
+static umode_t uniwill_bundle_is_visible(struct kobject *kobj, struct attribute *attr, int n)
+{
+	struct device_attribute *dev_attr = container_of(attr, struct device_attribute, attr);
+	struct uniwill_data *data = dev_get_drvdata(kobj_to_dev(kobj));
+	struct uniwill_bundle_attribute *battr = to_uniwill_bundle_attr(dev_attr);
+
+	if (!uniwill_profile_supported(data, battr->profile))
 		return 0;
-	case FAN_MODE_TURBO:
-		*profile = PLATFORM_PROFILE_PERFORMANCE;
+
+	if (dev_attr->show == uniwill_bundle_limit_show) {
+		if (!uniwill_limit_supported(data, battr->index))
+			return 0;
+	} else if (!test_bit(UNIWILL_FEATURE_OEM_3, data->features)) {
 		return 0;
-	default:
-		return -EINVAL;
 	}
+
+	return attr->mode;
 }
 
-static int uniwill_platform_profile_set(struct platform_profile_handler *pprof,
-					enum platform_profile_option profile)
+#define UNIWILL_BUNDLE_ATTR(_name, _show, _store, _profile, _index)			\
+	{										\
+		.dev_attr = __ATTR(_name, 0644, _show, _store),				\
+		.profile = _profile,							\
+		.index = _index,							\
+	}
+
+#define UNIWILL_BUNDLE_GROUP(_name, _index)						\
+	static struct uniwill_bundle_attribute uniwill_profile_##_name##_attrs[] = {	\
+		UNIWILL_BUNDLE_ATTR(pl1, uniwill_bundle_limit_show,			\
+				    uniwill_bundle_limit_store, _index,			\
+				    UNIWILL_LIMIT_PL1),					\
+		UNIWILL_BUNDLE_ATTR(pl2, uniwill_bundle_limit_show,			\
+				    uniwill_bundle_limit_store, _index,			\
+				    UNIWILL_LIMIT_PL2),					\
+		UNIWILL_BUNDLE_ATTR(pl4, uniwill_bundle_limit_show,			\
+				    uniwill_bundle_limit_store, _index,			\
+				    UNIWILL_LIMIT_PL4),					\
+		UNIWILL_BUNDLE_ATTR(ctgp_offset, uniwill_bundle_limit_show,		\
+				    uniwill_bundle_limit_store, _index,			\
+				    UNIWILL_LIMIT_CTGP_OFFSET),				\
+		UNIWILL_BUNDLE_ATTR(overboost, uniwill_bundle_flag_show,		\
+				    uniwill_bundle_flag_store, _index, OVERBOOST),	\
+		UNIWILL_BUNDLE_ATTR(fan_quiet, uniwill_bundle_flag_show,		\
+				    uniwill_bundle_flag_store, _index, FAN_QUIET),	\
+	};										\
+											\
+	static struct attribute *uniwill_profile_##_name##_group_attrs[] = {		\
+		&uniwill_profile_##_name##_attrs[0].dev_attr.attr,			\
+		&uniwill_profile_##_name##_attrs[1].dev_attr.attr,			\
+		&uniwill_profile_##_name##_attrs[2].dev_attr.attr,			\
+		&uniwill_profile_##_name##_attrs[3].dev_attr.attr,			\
+		&uniwill_profile_##_name##_attrs[4].dev_attr.attr,			\
+		&uniwill_profile_##_name##_attrs[5].dev_attr.attr,			\
+		NULL									\
+	};										\
+											\
+	static const struct attribute_group uniwill_profile_##_name##_group = {		\
+		.name = "profile_" #_name,						\
+		.attrs = uniwill_profile_##_name##_group_attrs,				\
+		.is_visible = uniwill_bundle_is_visible,				\
+	}
+
+UNIWILL_BUNDLE_GROUP(low_power, UNIWILL_PROFILE_LOW_POWER);
+UNIWILL_BUNDLE_GROUP(quiet, UNIWILL_PROFILE_QUIET);
+UNIWILL_BUNDLE_GROUP(balanced, UNIWILL_PROFILE_BALANCED);
+UNIWILL_BUNDLE_GROUP(balanced_performance, UNIWILL_PROFILE_BALANCED_PERFORMANCE);
+UNIWILL_BUNDLE_GROUP(performance, UNIWILL_PROFILE_PERFORMANCE);
+
+static ssize_t uniwill_supply_profile_show(struct device *dev, bool discharging, char *buf)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	int profile;
+
+	mutex_lock(&data->profile_lock);
+	profile = data->supply_profiles[discharging];
+	mutex_unlock(&data->profile_lock);
+
+	if (profile < 0)
+		return sysfs_emit(buf, "none\n");
+
+	return sysfs_emit(buf, "%s\n", uniwill_profiles[profile].name);
+}
+
+static ssize_t uniwill_supply_profile_store(struct device *dev, bool discharging,
+					    const char *buf, size_t count)
+{
+	struct uniwill_data *data = dev_get_drvdata(dev);
+	int profile, i;
+
+	if (sysfs_streq(buf, "none")) {
+		profile = -1;
+	} else {
+		profile = -EINVAL;
+		for (i = 0; i < UNIWILL_PROFILE_COUNT; i++) {
+			if (sysfs_streq(buf, uniwill_profiles[i].name)) {
+				profile = i;
+				break;
+			}
+		}
+
+		if (profile < 0)
+			return profile;
+
+		if (!uniwill_profile_supported(data, profile))
+			return -EOPNOTSUPP;
+	}
+
+	/* Takes effect the next time the power adapter is plugged or unplugged */
+	mutex_lock(&data->profile_lock);
+	data->supply_profiles[discharging] = profile;
+	mutex_unlock(&data->profile_lock);
+
+	return count;
+}
+
+static ssize_t ac_profile_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	return uniwill_supply_profile_show(dev, false, buf);
+}
+
+static ssize_t ac_profile_store(struct device *dev, struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	return uniwill_supply_profile_store(dev, false, buf, count);
+}
+
+static DEVICE_ATTR_RW(ac_profile);
+
+static ssize_t dc_profile_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	return uniwill_supply_profile_show(dev, true, buf);
+}
+
+static ssize_t dc_profile_store(struct device *dev, struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	return uniwill_supply_profile_store(dev, true, buf, count);
+}
+
+static DEVICE_ATTR_RW(dc_profile);
+
+static struct attribute *uniwill_supply_attrs[] = {
+	&dev_attr_ac_profile.attr,
+	&dev_attr_dc_profile.attr,
+	NULL
+};
+
+static const struct attribute_group uniwill_supply_group = {
+	.attrs = uniwill_supply_attrs,
+};
+
+static const struct attribute_group *uniwill_groups[] = {
+	&uniwill_pl1_group,
+	&uniwill_pl2_group,
+	&uniwill_pl4_group,
+	&uniwill_ctgp_offset_group,
+	&uniwill_tpp_offset_group,
+	&uniwill_dynamic_boost_group,
+	&uniwill_profile_low_power_group,
+	&uniwill_profile_quiet_group,
+	&uniwill_profile_balanced_group,
+	&uniwill_profile_balanced_performance_group,
+	&uniwill_profile_performance_group,
+	&uniwill_supply_group,
+	NULL
+};
+
+static void uniwill_supply_changed(struct uniwill_data *data)
 {
-	struct uniwill_data *data = container_of(pprof, struct uniwill_data, profile_handler);
-	unsigned int mask = FAN_MODE_USER | FAN_MODE_HIGH | FAN_MODE_TURBO;
 	unsigned int value;
+	int profile, ret;
 
-	switch (profile) {
-	case PLATFORM_PROFILE_BALANCED:
-		value = FAN_MODE_USER | FAN_MODE_HIGH;
-		break;
-	case PLATFORM_PROFILE_BALANCED_PERFORMANCE:
-		value = 0x00;
-		break;
-	case PLATFORM_PROFILE_PERFORMANCE:
-		value = FAN_MODE_TURBO;
-		break;
-	default:
-		return -EINVAL;
+	ret = regmap_read(data->regmap, EC_ADDR_BAT_STATUS, &value);
+	if (ret < 0) {
+		dev_err(&data->wdev->dev, "Failed to read battery status: %d\n", ret);
+		return;
+	}
+
+	mutex_lock(&data->profile_lock);
+	profile = data->supply_profiles[!!(value & BAT_DISCHARGING)];
+	mutex_unlock(&data->profile_lock);
+
+	if (profile < 0)
+		return;
+
+	ret = uniwill_select_profile(data, profile);
+	if (ret < 0) {
+		dev_err(&data->wdev->dev, "Failed to switch to %s profile: %d\n",
+			uniwill_profiles[profile].name, ret);
+		return;
 	}
 
-	return regmap_update_bits(data->regmap, EC_ADDR_MANUAL_FAN_CTRL, mask, value);
+	platform_profile_notify();
 }
 
 static int uniwill_wmi_notify_call(struct notifier_block *nb, unsigned long action, void *data)
 {
-	u32 *event = data;
-
-	if (*event != UNIWILL_OSD_PERF_MODE_CHANGED)
-		return NOTIFY_DONE;
+	struct uniwill_data *uniwill = container_of(nb, struct uniwill_data, notifier);
+	const u32 *events = data;
+	bool supply_changed = false;
+	int ret = NOTIFY_DONE;
+	unsigned long i;
+
+	for (i = 0; i < action; i++) {
+		switch (events[i]) {
+		case UNIWILL_OSD_PERF_MODE_CHANGED:
+			platform_profile_cycle();
+			ret = NOTIFY_OK;
+			break;
+		case UNIWILL_OSD_DC_ADAPTER_CHANGED:
+			supply_changed = true;
+			ret = NOTIFY_OK;
+			break;
+		default:
+			break;
+		}
+	}
 
-	platform_profile_cycle();
+	/* Only the final power supply state of a batch matters */
+	if (supply_changed)
+		uniwill_supply_changed(uniwill);
 
-	return NOTIFY_OK;
+	return ret;
 }
 
 static void devm_platform_profile_remove(void *data)
@@ -656,31 +3334,165 @@ static int devm_platform_profile_register(struct device *dev, struct platform_pr
 	return devm_add_action_or_reset(dev, devm_platform_profile_remove, NULL);
 }
 
+static int uniwill_bundles_init(struct uniwill_data *data)
+{
+	struct uniwill_limit_range *limits;
+	struct uniwill_bundle *bundle;
+	unsigned int value, pl1;
+	int ret, i, j;
+
+	ret = devm_mutex_init(&data->wdev->dev, &data->profile_lock);
+	if (ret < 0)
+		return ret;
+
+	/* Without EC_ADDR_OEM_3 the profiles only switch the fan mode and the power limits */
+	ret = regmap_read(data->regmap, EC_ADDR_OEM_3, &value);
+	if (ret < 0) {
+		dev_warn(&data->wdev->dev, "Failed to read OEM settings: %d\n", ret);
+		value = 0;
+	} else {
+		__set_bit(UNIWILL_FEATURE_OEM_3, data->features);
+	}
+
+	/* Start with the factory settings, the cTGP offset is only changed on request */
+	for (i = 0; i < UNIWILL_PROFILE_COUNT; i++) {
+		bundle = &data->bundles[i];
+
+		for (j = 0; j < UNIWILL_LIMIT_COUNT; j++)
+			bundle->limits[j] = data->limits[j].default_value;
+
+		bundle->oem_3 = value & OVERBOOST;
+	}
+
+	limits = data->limits;
+	pl1 = limits[UNIWILL_LIMIT_PL1].default_value;
+
+	/* Trade throughput for runtime and a lower fan ceiling */
+	bundle = &data->bundles[UNIWILL_PROFILE_LOW_POWER];
+	bundle->limits[UNIWILL_LIMIT_PL1] = max(pl1 / 2, 1U);
+	bundle->limits[UNIWILL_LIMIT_PL2] = max(pl1 / 2, 1U);
+	bundle->oem_3 = FAN_QUIET;
+
+	bundle = &data->bundles[UNIWILL_PROFILE_QUIET];
+	bundle->limits[UNIWILL_LIMIT_PL1] = max(pl1 * 3 / 4, 1U);
+	bundle->limits[UNIWILL_LIMIT_PL2] = pl1;
+	bundle->oem_3 = FAN_QUIET;
+
+	/* Sustain the factory burst power limit when performance is requested */
+	bundle = &data->bundles[UNIWILL_PROFILE_PERFORMANCE];
+	bundle->limits[UNIWILL_LIMIT_PL1] = limits[UNIWILL_LIMIT_PL2].default_value;
+	bundle->oem_3 = OVERBOOST;
+
+	return 0;
+}
+
 static int uniwill_platform_profile_init(struct uniwill_data *data)
 {
-	int ret;
+	int i;
 
-	set_bit(PLATFORM_PROFILE_BALANCED, data->profile_handler.choices);
-	set_bit(PLATFORM_PROFILE_BALANCED_PERFORMANCE, data->profile_handler.choices);
-	set_bit(PLATFORM_PROFILE_PERFORMANCE, data->profile_handler.choices);
+	for (i = 0; i < UNIWILL_PROFILE_COUNT; i++) {
+		if (!uniwill_profile_supported(data, i))
+			continue;
+
+		set_bit(uniwill_profiles[i].option, data->profile_handler.choices);
+	}
 
 	data->profile_handler.profile_get = uniwill_platform_profile_get;
 	data->profile_handler.profile_set = uniwill_platform_profile_set;
 
-	ret = devm_platform_profile_register(&data->wdev->dev, &data->profile_handler);
-	if (ret < 0)
-		return ret;
+	return devm_platform_profile_register(&data->wdev->dev, &data->profile_handler);
+}
 
+static int uniwill_notifier_init(struct uniwill_data *data)
+{
 	data->notifier.notifier_call = uniwill_wmi_notify_call;
 
 	return devm_uniwill_wmi_register_notifier(&data->wdev->dev, &data->notifier);
 }
 
+static int uniwill_ec_probe_wide_read(struct uniwill_data *data)
+{
+	u8 romid[ROMID_LENGTH];
+	unsigned int i;
+	u32 output;
+	int ret;
+
+	/* This is only an optimization, so fall back to single byte reads on errors */
+	ret = regmap_bulk_read(data->regmap, EC_ADDR_ROMID_START, romid, sizeof(romid));
+	if (ret < 0) {
+		dev_dbg(&data->wdev->dev, "Failed to read ROM ID: %d\n", ret);
+		return 0;
+	}
+
+	dev_dbg(&data->wdev->dev, "ROM ID: %*phN\n", ROMID_LENGTH, romid);
+
+	/* A ROM ID consisting of identical bytes cannot tell us anything */
+	if (!memchr_inv(romid, romid[0], sizeof(romid)))
+		return 0;
+
+	for (i = 0; i + sizeof(output) <= sizeof(romid); i += sizeof(output)) {
+		ret = uniwill_ec_reg_read(data, EC_ADDR_ROMID_START + i, 1, &output);
+		if (ret < 0) {
+			dev_dbg(&data->wdev->dev, "Failed to probe wide EC reads: %d\n", ret);
+			return 0;
+		}
+
+		if (output != get_unaligned_le32(&romid[i]))
+			return 0;
+	}
+
+	dev_dbg(&data->wdev->dev, "EC supports reading multiple registers at once\n");
+	data->ec_wide_read = true;
+
+	return 0;
+}
+
+struct uniwill_capability {
+	unsigned int reg;
+	unsigned int mask;
+	enum uniwill_feature feature;
+};
+
+/* Only capability bits with a known meaning are used */
+static const struct uniwill_capability uniwill_capabilities[] = {
+	{ EC_ADDR_SUPPORT_2, SILENT_MODE, UNIWILL_FEATURE_SILENT_MODE },
+};
+
+static void uniwill_ec_probe_features(struct uniwill_data *data)
+{
+	u8 values[EC_ADDR_SUPPORT_2 - EC_ADDR_SUPPORT_1 + 1];
+	const struct uniwill_capability *cap;
+	int ret, i;
+
+	/* Later accesses are served by the regmap cache */
+	ret = regmap_bulk_read(data->regmap, EC_ADDR_SUPPORT_1, values, sizeof(values));
+	if (ret < 0) {
+		/* Only optional features depend on the capabilities */
+		dev_warn(&data->wdev->dev, "Failed to read EC capabilities: %d\n", ret);
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(uniwill_capabilities); i++) {
+		cap = &uniwill_capabilities[i];
+
+		if (values[cap->reg - EC_ADDR_SUPPORT_1] & cap->mask)
+			__set_bit(cap->feature, data->features);
+	}
+
+	dev_dbg(&data->wdev->dev, "Features: %*pb\n", UNIWILL_FEATURE_COUNT, data->features);
+}
+
 static int uniwill_ec_init(struct uniwill_data *data)
 {
 	unsigned int value;
 	int ret;
 
+	ret = uniwill_ec_probe_wide_read(data);
+	if (ret < 0)
+		return ret;
+
+	uniwill_ec_probe_features(data);
+
 	ret = regmap_read(data->regmap, EC_ADDR_PROJECT_ID, &value);
 	if (ret < 0)
 		return ret;
@@ -695,7 +3507,12 @@ static int uniwill_ec_init(struct uniwill_data *data)
 	return devm_add_action_or_reset(&data->wdev->dev, uniwill_disable_manual_control, data);
 }
 
-static int uniwill_probe(struct wmi_device *wdev, const void *context)
+/*
+ * Sets up the driver state without registering any interfaces, which allows
+ * the KUnit tests to use it on a WMI device which was never registered.
+ */
+VISIBLE_IF_KUNIT struct uniwill_data *uniwill_data_init(struct wmi_device *wdev,
+							unsigned int coalesce_delay)
 {
 	struct uniwill_data *data;
 	struct regmap *regmap;
@@ -703,34 +3520,87 @@ static int uniwill_probe(struct wmi_device *wdev, const void *context)
 
 	data = devm_kzalloc(&wdev->dev, sizeof(*data), GFP_KERNEL);
 	if (!data)
-		return -ENOMEM;
+		return ERR_PTR(-ENOMEM);
 
 	data->wdev = wdev;
 	dev_set_drvdata(&wdev->dev, data);
 
+	ret = devm_mutex_init(&wdev->dev, &data->ec_lock);
+	if (ret < 0)
+		return ERR_PTR(ret);
+
+	seqlock_init(&data->sensor_lock);
+
+	/* The statistics are updated by the regmap bus and thus must outlive the regmap */
+	ret = uniwill_debugfs_init(data);
+	if (ret < 0)
+		return ERR_PTR(ret);
+
 	regmap = devm_regmap_init(&wdev->dev, &uniwill_ec_bus, data, &uniwill_ec_config);
 	if (IS_ERR(regmap))
-		return PTR_ERR(regmap);
+		return ERR_CAST(regmap);
 
 	data->regmap = regmap;
 
 	ret = uniwill_ec_init(data);
 	if (ret < 0)
-		return ret;
+		return ERR_PTR(ret);
+
+	ret = uniwill_coalesce_init(data, coalesce_delay);
+	if (ret < 0)
+		return ERR_PTR(ret);
+
+	ret = uniwill_limits_init(data);
+	if (ret < 0)
+		return ERR_PTR(ret);
+
+	ret = uniwill_bundles_init(data);
+	if (ret < 0)
+		return ERR_PTR(ret);
+
+	/* Leave the profile alone on power supply changes until configured */
+	data->supply_profiles[0] = -1;
+	data->supply_profiles[1] = -1;
+
+	ret = uniwill_fan_init(data);
+	if (ret < 0)
+		return ERR_PTR(ret);
+
+	return data;
+}
+EXPORT_SYMBOL_IF_KUNIT(uniwill_data_init);
+
+static int uniwill_probe(struct wmi_device *wdev, const void *context)
+{
+	struct uniwill_data *data;
+	int ret;
+
+	data = uniwill_data_init(wdev, write_coalesce_delay);
+	if (IS_ERR(data))
+		return PTR_ERR(data);
 
 	ret = uniwill_platform_profile_init(data);
 	if (ret < 0)
 		return ret;
 
-	return uniwill_hwmon_init(data);
+	ret = uniwill_hwmon_init(data);
+	if (ret < 0)
+		return ret;
+
+	return uniwill_notifier_init(data);
 }
 
-static int uniwill_suspend(struct device *dev)
+VISIBLE_IF_KUNIT int uniwill_suspend(struct device *dev)
 {
 	struct uniwill_data *data = dev_get_drvdata(dev);
 	unsigned int value;
 	int ret;
 
+	cancel_delayed_work_sync(&data->flush_work);
+	ret = uniwill_flush_writes(data);
+	if (ret < 0)
+		return ret;
+
 	/*
 	 * Make sure the EC_ADDR_AP_OEM register in the regmap cache is current
 	 * before bypassing it.
@@ -739,6 +3609,13 @@ static int uniwill_suspend(struct device *dev)
 	if (ret < 0)
 		return ret;
 
+	if (data->sample_interval) {
+		cancel_delayed_work_sync(&data->sample_work);
+		uniwill_invalidate_snapshot(data);
+	}
+
+	cancel_delayed_work_sync(&data->control_work);
+
 	regcache_cache_bypass(data->regmap, true);
 	regmap_update_bits(data->regmap, EC_ADDR_AP_OEM, ENABLE_MANUAL_CTRL, 0);
 	regcache_cache_bypass(data->regmap, false);
@@ -748,15 +3625,30 @@ static int uniwill_suspend(struct device *dev)
 
 	return 0;
 }
+EXPORT_SYMBOL_IF_KUNIT(uniwill_suspend);
 
-static int uniwill_resume(struct device *dev)
+VISIBLE_IF_KUNIT int uniwill_resume(struct device *dev)
 {
 	struct uniwill_data *data = dev_get_drvdata(dev);
+	int ret;
 
 	regcache_cache_only(data->regmap, false);
 
-	return regcache_sync(data->regmap);
+	ret = regcache_sync(data->regmap);
+	if (ret < 0)
+		return ret;
+
+	if (data->sample_interval) {
+		data->sample_delay = data->sample_interval;
+		schedule_delayed_work(&data->sample_work, 0);
+	}
+
+	if (uniwill_control_active(data))
+		schedule_delayed_work(&data->control_work, 0);
+
+	return 0;
 }
+EXPORT_SYMBOL_IF_KUNIT(uniwill_resume);
 
 static DEFINE_SIMPLE_DEV_PM_OPS(uniwill_pm_ops, uniwill_suspend, uniwill_resume);
 
@@ -776,6 +3668,7 @@ static struct wmi_driver uniwill_driver = {
 		.name = DRIVER_NAME,
 		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 		.pm = pm_sleep_ptr(&uniwill_pm_ops),
+		.dev_groups = uniwill_groups,
 	},
 	.id_table = uniwill_id_table,
 	.probe = uniwill_probe,
@@ -0,0 +1,251 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Internal definitions of the Uniwill notebook driver.
+ *
+ * Copyright (C) 2024 Armin Wolf <W_Armin@gmx.de>
+ */
+
+#ifndef UNIWILL_LAPTOP_H
+#define UNIWILL_LAPTOP_H
+
+#include <linux/bits.h>
+#include <linux/hwmon.h>
+#include <linux/kconfig.h>
+#include <linux/platform_profile.h>
+#include <linux/types.h>
+
+#define EC_ADDR_BAT_STATUS	0x0432
+#define BAT_DISCHARGING		BIT(0)
+
+#define EC_ADDR_CPU_TEMP	0x043E
+
+#define EC_ADDR_GPU_TEMP	0x044F
+
+#define EC_ADDR_MAIN_FAN_RPM_1	0x0464
+
+#define EC_ADDR_MAIN_FAN_RPM_2	0x0465
+
+#define EC_ADDR_SECOND_FAN_RPM_1	0x046C
+
+#define EC_ADDR_SECOND_FAN_RPM_2	0x046D
+
+#define EC_ADDR_BAT_ALLERT	0x0494
+
+#define EC_ADDR_PROJECT_ID	0x0740
+
+#define EC_ADDR_AP_OEM		0x0741
+#define	ENABLE_MANUAL_CTRL	BIT(0)
+#define ITE_KBD_EFFECT_REACTIVE	BIT(3)
+#define FAN_ABNORMAL		BIT(5)
+
+#define EC_ADDR_SUPPORT_5	0x0742
+#define FAN_TURBO_SUPPORTED	BIT(4)
+#define FAN_SUPPORT		BIT(5)
+#define CHARGIN_PRIO_SUPPORTED	BIT(5)	// TODO Conflict!
+
+#define EC_ADDR_CTGP_DB_CTRL	0x0743
+#define CTGP_DB_GENERAL_ENABLE	BIT(0)
+#define CTGP_DB_DB_ENABLE	BIT(1)
+#define CTGP_DB_CTGP_ENABLE	BIT(2)
+
+#define EC_ADDR_CTGP_OFFSET	0x0744
+
+#define EC_ADDR_TPP_OFFSET	0x0745
+
+#define EC_ADDR_MAX_TGP		0x0746
+
+#define EC_ADDR_LIGHTBAR_CTRL	0x0748
+#define LIGHTBAR_POWER_SAFE	BIT(1)
+#define LIGHTBAR_S0_OFF		BIT(2)
+#define LIGHTBAR_S3_OFF		BIT(3)
+#define LIGHTBAR_RAINBOW	BIT(7)
+
+#define EC_ADDR_LIGHTBAR_RED	0x0749
+
+#define EC_ADDR_LIGHTBAR_GREEN	0x074A
+
+#define EC_ADDR_LIGHTBAR_BLUE	0x074B
+
+#define EC_ADDR_BIOS_OEM	0x074E
+#define FN_LOCK_STATUS		BIT(4)
+
+#define EC_ADDR_MANUAL_FAN_CTRL	0x0751
+#define FAN_LEVEL_MASK		GENMASK(2, 0)
+#define FAN_MODE_TURBO		BIT(4)
+#define FAN_MODE_HIGH		BIT(5)
+#define FAN_MODE_BOOST		BIT(6)
+#define FAN_MODE_USER		BIT(7)
+
+#define EC_ADDR_SUPPORT_1	0x0765
+#define AIRPLANE_MODE		BIT(0)
+#define GPS_SWITCH		BIT(1)
+#define OVERCLOCK		BIT(2)
+#define MACRO_KEY		BIT(3)
+#define SHORTCUT_KEY		BIT(4)
+#define SUPER_KEY_LOCK		BIT(5)
+#define LIGHTBAR		BIT(6)
+#define FAN_BOOST		BIT(7)	/* Seems to be unrelated to manual fan control */
+
+#define EC_ADDR_SUPPORT_2	0x0766
+#define SILENT_MODE		BIT(0)
+#define USB_CHARGING		BIT(1)
+#define SINGLE_ZONE_KBD		BIT(2)
+#define CHINA_MODE		BIT(5)
+#define MY_BATTERY		BIT(6)
+
+#define EC_ADDR_TRIGGER		0x0767
+#define TRIGGER_SUPER_KEY_LOCK	BIT(0)
+#define TRIGGER_LIGHTBAR	BIT(1)
+#define TRIGGER_FAN_BOOST	BIT(2)
+#define TRIGGER_SILENT_MODE	BIT(3)
+#define TRIGGER_USB_CHARGING	BIT(4)
+#define RGB_APPLY_COLOR		BIT(5)
+#define RGB_RAINBOW_EFFECT	BIT(7)
+
+#define EC_ADDR_SWITCH_STATUS	0x0768
+#define SUPER_KEY_LOCK_STATUS	BIT(0)
+#define LIGHTBAR_STATUS		BIT(1)
+#define FAN_BOOST_STATUS	BIT(2)
+
+#define EC_ADDR_RGB_RED		0x0769
+
+#define EC_ADDR_RGB_GREEN	0x076A
+
+#define EC_ADDR_RGB_BLUE	0x076B
+
+#define EC_ADDR_ROMID_START	0x0770
+#define ROMID_LENGTH		14
+
+#define EC_ADDR_ROMID_EXTRA_1	0x077E
+
+#define EC_ADDR_ROMID_EXTRA_2	0x077F
+
+#define EC_ADDR_BIOS_OEM_2	0x0782
+#define FAN_V2_NEW		BIT(0)
+#define FAN_QKEY		BIT(1)
+#define FAN_TABLE_OFFICE_MODE	BIT(2)
+#define FAN_V3			BIT(3)
+#define DEFAULT_MODE		BIT(4)
+
+#define EC_ADDR_PL1_SETTING	0x0783
+
+#define EC_ADDR_PL2_SETTING	0x0784
+
+#define EC_ADDR_PL4_SETTING	0x0785
+
+/*
+ * Temperatures in degree Celsius at which the EC switches to the next
+ * fan level when in automatic mode, used for both fans.
+ */
+#define EC_ADDR_FAN_DEFAULT	0x0786
+
+#define EC_ADDR_KBD_STATUS	0x078C
+#define KBD_WHITE_ONLY		BIT(0)	// ~single color
+#define KBD_SINGLE_COLOR_OFF	BIT(1)
+#define KBD_TURBO_LEVEL_MASK	GENMASK(3, 2)
+#define KBD_APPLY		BIT(4)
+#define KBD_BRIGHTNESS		GENMASK(7, 5)
+
+#define EC_ADDR_FAN_CTRL	0x078E
+#define FAN3P5			BIT(1)
+#define CHARGING_PROFILE	BIT(3)
+#define UNIVERSAL_FAN_CTRL	BIT(6)
+
+#define EC_ADDR_BIOS_OEM_3	0x07A3
+#define FAN_REDUCED_DURY_CYCLE	BIT(5)
+#define FAN_ALWAYS_ON		BIT(6)
+
+#define EC_ADDR_BIOS_BYTE	0x07A4
+#define FN_LOCK_SWITCH		BIT(3)
+
+#define EC_ADDR_OEM_3		0x07A5
+#define POWER_LED_MASK		GENMASK(1, 0)
+#define POWER_LED_LEFT		0x00
+#define POWER_LED_BOTH		0x01
+#define POWER_LED_NONE		0x02
+#define FAN_QUIET		BIT(2)
+#define OVERBOOST		BIT(4)
+#define HIGH_POWER		BIT(7)
+
+#define EC_ADDR_OEM_4		0x07A6
+#define OVERBOOST_DYN_TEMP_OFF	BIT(1)
+#define TOUCHPAD_TOGGLE_OFF	BIT(6)
+// TODO
+
+#define EC_ADDR_CHARGE_CTRL	0x07B9
+#define CHARGE_CTRL_MASK	GEMASK(6, 0)
+#define CHARGE_CTRL_REACHED	BIT(7)
+
+#define EC_ADDR_CHARGE_PRIO	0x07CC
+#define CHARGING_PERFORMANCE	BIT(7)
+
+#define EC_ADDR_PWM_1		0x1804
+
+#define EC_ADDR_PWM_2		0x1809
+
+#define FAN_CURVE_LENGTH	5
+
+#define UNIWILL_CHANNELS	2
+
+struct acpi_buffer;
+struct device;
+struct uniwill_data;
+struct wmi_device;
+
+struct uniwill_method_buffer {
+	__le16 address;
+	__le16 data;
+	__le16 operation;
+	__le16 reserved;
+} __packed;
+
+struct uniwill_sensors {
+	unsigned int temp[UNIWILL_CHANNELS];
+	unsigned int fan[UNIWILL_CHANNELS];
+	unsigned int pwm[UNIWILL_CHANNELS];
+};
+
+enum uniwill_limit_index {
+	UNIWILL_LIMIT_PL1,
+	UNIWILL_LIMIT_PL2,
+	UNIWILL_LIMIT_PL4,
+	UNIWILL_LIMIT_CTGP_OFFSET,
+	UNIWILL_LIMIT_TPP_OFFSET,
+	UNIWILL_LIMIT_COUNT
+};
+
+struct uniwill_pending_write {
+	unsigned int reg;
+	unsigned int mask;
+	unsigned int value;
+};
+
+#if IS_ENABLED(CONFIG_KUNIT)
+int uniwill_parse_reply(const struct acpi_buffer *out, u32 *output);
+int uniwill_get_set_ulong(struct uniwill_data *data, struct uniwill_method_buffer *input,
+			  u32 *output);
+int uniwill_flush_writes(struct uniwill_data *data);
+int uniwill_update_bits(struct uniwill_data *data, unsigned int reg, unsigned int mask,
+			unsigned int value);
+int uniwill_read_reg(struct uniwill_data *data, unsigned int reg, unsigned int *value);
+int uniwill_write_reg(struct uniwill_data *data, unsigned int reg, unsigned int value);
+int uniwill_write_transaction(struct uniwill_data *data,
+			      const struct uniwill_pending_write *writes, unsigned int count,
+			      unsigned int *old);
+u8 uniwill_telemetry_profile(enum platform_profile_option profile);
+bool uniwill_sensors_changed(const struct uniwill_sensors *old,
+			     const struct uniwill_sensors *new);
+unsigned int uniwill_curve_lookup(const u8 *temps, const u8 *pwm, unsigned int temp);
+unsigned int uniwill_fan_target(const u8 *temps, const u8 *pwm, unsigned int temp,
+				unsigned int value, unsigned int hysteresis);
+bool uniwill_limits_ordered(const unsigned int *limits);
+int uniwill_read(struct device *dev, enum hwmon_sensor_types type, u32 attr, int channel,
+		 long *val);
+int uniwill_profile_get(struct uniwill_data *data, enum platform_profile_option *profile);
+int uniwill_profile_set(struct uniwill_data *data, enum platform_profile_option profile);
+struct uniwill_data *uniwill_data_init(struct wmi_device *wdev, unsigned int coalesce_delay);
+int uniwill_suspend(struct device *dev);
+int uniwill_resume(struct device *dev);
+#endif
+
+#endif
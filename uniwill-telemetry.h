@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later WITH Linux-syscall-note */
+/*
+ * Telemetry interface of the Linux driver for Uniwill notebooks.
+ *
+ * Copyright (C) 2024 Armin Wolf <W_Armin@gmx.de>
+ */
+
+#ifndef UNIWILL_TELEMETRY_H
+#define UNIWILL_TELEMETRY_H
+
+#include <linux/types.h>
+
+#define UNIWILL_TELEMETRY_PROFILE_LOW_POWER		0
+#define UNIWILL_TELEMETRY_PROFILE_QUIET			1
+#define UNIWILL_TELEMETRY_PROFILE_BALANCED		2
+#define UNIWILL_TELEMETRY_PROFILE_BALANCED_PERFORMANCE	3
+#define UNIWILL_TELEMETRY_PROFILE_PERFORMANCE		4
+#define UNIWILL_TELEMETRY_PROFILE_UNKNOWN		0xFF
+
+/*
+ * Record read from /dev/uniwill-telemetry<N> after each sensor sample.
+ *
+ * @timestamp:	CLOCK_MONOTONIC time of the sample in nanoseconds
+ * @fan_rpm:	Speed of the main and secondary fan in RPM
+ * @cpu_temp:	CPU temperature in degree Celsius
+ * @gpu_temp:	GPU temperature in degree Celsius
+ * @pwm:	Duty cycle of the main and secondary fan (0 - 255)
+ * @profile:	Current platform profile (UNIWILL_TELEMETRY_PROFILE_*)
+ */
+struct uniwill_telemetry_record {
+	__u64 timestamp;
+	__u16 fan_rpm[2];
+	__u8 cpu_temp;
+	__u8 gpu_temp;
+	__u8 pwm[2];
+	__u8 profile;
+	__u8 reserved[7];
+};
+
+/*
+ * Layout of the read-only page which can be mapped from /dev/uniwill-telemetry<N>.
+ *
+ * @sequence:	Odd while the driver updates the page
+ * @latest:	Most recent sensor sample
+ *
+ * Readers must read @sequence with acquire semantics, retry while it is odd,
+ * copy @latest and then retry if @sequence changed in the meantime.
+ */
+struct uniwill_telemetry_page {
+	__u32 sequence;
+	__u32 reserved;
+	struct uniwill_telemetry_record latest;
+};
+
+#endif /* UNIWILL_TELEMETRY_H */
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Tracepoints for the Linux hotkey driver for Uniwill notebooks.
+ *
+ * Copyright (C) 2024 Armin Wolf <W_Armin@gmx.de>
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM uniwill_wmi
+
+#if !defined(UNIWILL_WMI_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define UNIWILL_WMI_TRACE_H
+
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+
+TRACE_EVENT(uniwill_wmi_event,
+	TP_PROTO(u32 event, unsigned int count, int ret, u64 duration),
+
+	TP_ARGS(event, count, ret, duration),
+
+	TP_STRUCT__entry(
+		__field(u32, event)
+		__field(unsigned int, count)
+		__field(int, ret)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->event = event;
+		__entry->count = count;
+		__entry->ret = ret;
+		__entry->duration = duration;
+	),
+
+	TP_printk("event=0x%02x count=%u ret=0x%x duration=%llu ns", __entry->event,
+		  __entry->count, __entry->ret, __entry->duration)
+);
+
+#endif /* UNIWILL_WMI_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE uniwill-wmi-trace
+
+#include <trace/define_trace.h>
@@ -6,28 +6,48 @@
  */
 
 #include <linux/acpi.h>
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/errno.h>
 #include <linux/export.h>
 #include <linux/input.h>
 #include <linux/input/sparse-keymap.h>
+#include <linux/kfifo.h>
+#include <linux/ktime.h>
 #include <linux/mod_devicetable.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/notifier.h>
 #include <linux/printk.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/wmi.h>
+#include <linux/workqueue.h>
 
 #include "uniwill-wmi.h"
 
+#define CREATE_TRACE_POINTS
+#include "uniwill-wmi-trace.h"
+
 #define DRIVER_NAME		"uniwill-wmi"
 #define UNIWILL_EVENT_GUID	"ABBC0F72-8EA1-11D1-00A0-C90629100000"
 
+#define UNIWILL_EVENT_RING_SIZE	64
+#define UNIWILL_EVENT_BATCH_SIZE	16
+
 struct uniwill_wmi_data {
-	struct mutex input_lock;	/* Protects input sequence during notify */
+	struct mutex input_lock;	/* Protects input sequence and event producer during notify */
 	struct input_dev *input_device;
+	struct workqueue_struct *event_wq;
+	struct work_struct event_work;
+	DECLARE_KFIFO(events, u32, UNIWILL_EVENT_RING_SIZE);
+	atomic64_t events_received;
+	atomic64_t events_dropped;
+	atomic64_t events_delivered;
+	atomic64_t batches;
+	unsigned int max_depth;
 };
 
 static BLOCKING_NOTIFIER_HEAD(uniwill_wmi_chain_head);
@@ -137,24 +157,101 @@ int devm_uniwill_wmi_register_notifier(struct device *dev, struct notifier_block
 }
 EXPORT_SYMBOL_NS_GPL(devm_uniwill_wmi_register_notifier, UNIWILL);
 
+static void uniwill_wmi_event_work(struct work_struct *work)
+{
+	struct uniwill_wmi_data *data = container_of(work, struct uniwill_wmi_data, event_work);
+	u32 events[UNIWILL_EVENT_BATCH_SIZE];
+	unsigned int count;
+	u64 start;
+	int ret;
+
+	while ((count = kfifo_out(&data->events, events, ARRAY_SIZE(events)))) {
+		start = ktime_get_ns();
+		ret = blocking_notifier_call_chain(&uniwill_wmi_chain_head, count, events);
+		trace_uniwill_wmi_event(events[0], count, ret, ktime_get_ns() - start);
+
+		atomic64_add(count, &data->events_delivered);
+		atomic64_inc(&data->batches);
+	}
+}
+
 static void uniwill_wmi_notify(struct wmi_device *wdev, union acpi_object *obj)
 {
 	struct uniwill_wmi_data *data = dev_get_drvdata(&wdev->dev);
+	bool queued;
 	u32 value;
-	int ret;
 
 	if (obj->type != ACPI_TYPE_INTEGER)
 		return;
 
 	value = obj->integer.value;
 
-	ret = blocking_notifier_call_chain(&uniwill_wmi_chain_head, 0, &value);
-	if (ret == NOTIFY_BAD)
-		return;
+	atomic64_inc(&data->events_received);
 
 	mutex_lock(&data->input_lock);
+
+	/*
+	 * Subscribers might need to access the EC, so they are called from
+	 * a separate workqueue to avoid stalling the ACPI notify queue.
+	 */
+	queued = kfifo_put(&data->events, value);
+	if (queued)
+		data->max_depth = max(data->max_depth, kfifo_len(&data->events));
+
 	sparse_keymap_report_event(data->input_device, value, 1, true);
+
+	mutex_unlock(&data->input_lock);
+
+	if (queued) {
+		queue_work(data->event_wq, &data->event_work);
+	} else {
+		atomic64_inc(&data->events_dropped);
+		dev_warn_ratelimited(&wdev->dev, "Event ring full, dropping event 0x%02x\n", value);
+	}
+}
+
+static int uniwill_wmi_events_show(struct seq_file *m, void *unused)
+{
+	struct uniwill_wmi_data *data = m->private;
+
+	seq_printf(m, "received\t%lld\n", atomic64_read(&data->events_received));
+	seq_printf(m, "dropped\t\t%lld\n", atomic64_read(&data->events_dropped));
+	seq_printf(m, "delivered\t%lld\n", atomic64_read(&data->events_delivered));
+	seq_printf(m, "batches\t\t%lld\n", atomic64_read(&data->batches));
+
+	mutex_lock(&data->input_lock);
+	seq_printf(m, "max_depth\t%u\n", data->max_depth);
 	mutex_unlock(&data->input_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(uniwill_wmi_events);
+
+static void uniwill_wmi_debugfs_remove(void *context)
+{
+	struct dentry *dir = context;
+
+	debugfs_remove_recursive(dir);
+}
+
+static int uniwill_wmi_debugfs_init(struct wmi_device *wdev, struct uniwill_wmi_data *data)
+{
+	struct dentry *dir;
+	char name[64];
+
+	snprintf(name, sizeof(name), "%s-%s", DRIVER_NAME, dev_name(&wdev->dev));
+	dir = debugfs_create_dir(name, NULL);
+
+	debugfs_create_file("events", 0444, dir, data, &uniwill_wmi_events_fops);
+
+	return devm_add_action_or_reset(&wdev->dev, uniwill_wmi_debugfs_remove, dir);
+}
+
+static void uniwill_wmi_destroy_workqueue(void *context)
+{
+	struct workqueue_struct *wq = context;
+
+	destroy_workqueue(wq);
 }
 
 static int uniwill_wmi_probe(struct wmi_device *wdev, const void *context)
@@ -170,6 +267,17 @@ static int uniwill_wmi_probe(struct wmi_device *wdev, const void *context)
 	if (ret < 0)
 		return ret;
 
+	INIT_KFIFO(data->events);
+	INIT_WORK(&data->event_work, uniwill_wmi_event_work);
+
+	data->event_wq = alloc_ordered_workqueue("uniwill-wmi-%s", 0, dev_name(&wdev->dev));
+	if (!data->event_wq)
+		return -ENOMEM;
+
+	ret = devm_add_action_or_reset(&wdev->dev, uniwill_wmi_destroy_workqueue, data->event_wq);
+	if (ret < 0)
+		return ret;
+
 	dev_set_drvdata(&wdev->dev, data);
 
 	data->input_device = devm_input_allocate_device(&wdev->dev);
@@ -184,7 +292,11 @@ static int uniwill_wmi_probe(struct wmi_device *wdev, const void *context)
 	data->input_device->phys = "wmi/input0";
 	data->input_device->id.bustype = BUS_HOST;
 
-	return input_register_device(data->input_device);
+	ret = input_register_device(data->input_device);
+	if (ret < 0)
+		return ret;
+
+	return uniwill_wmi_debugfs_init(wdev, data);
 }
 
 /*
@@ -59,6 +59,11 @@
 
 struct notifier_block;
 
+/*
+ * Events are delivered to the notifier chain in batches, with the number
+ * of events being passed as action and the event codes as an array of u32.
+ */
+
 int uniwill_wmi_register_notifier(struct notifier_block *nb);
 int uniwill_wmi_unregister_notifier(struct notifier_block *nb);
 int devm_uniwill_wmi_register_notifier(struct device *dev, struct notifier_block *nb);